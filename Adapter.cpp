@@ -24,7 +24,7 @@ public:
 
 
 class ClassAdapter : public Target, private Adaptee {
-    void do_logic() { this->do_logic_another_way(); }
+    void do_logic() override { this->do_logic_another_way(); }
 };
 
 
@@ -0,0 +1,212 @@
+/*
+ * Adapter pattern: batch adapter
+ *
+ * Intent: same as in Adapter.cpp, objects with incompatible interfaces work together.
+ * ObjectAdapter there translates every do_logic() into a call of the vendor API, so each
+ * request pays a virtual call plus the fixed cost of a vendor call (here a lock and a
+ * session check). BatchAdapter takes a span of requests and, when the adaptee has a bulk API,
+ * translates them into one bulk call. Adaptees without one get a loop over the single call.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+using Request = std::int64_t;   // temperature in millidegrees of Celsius
+using Reply = std::int64_t;     // the same in millidegrees of Fahrenheit
+
+
+// Vendor API, one call per request. Every call locks the session, like most thread-safe libraries do.
+class Adaptee {
+public:
+    [[gnu::noinline]] Reply do_logic_another_way(Request request) {
+        std::lock_guard lock(_mutex);
+        check_session();
+        return convert(request);
+    }
+
+    std::uint64_t calls() const { return _calls; }
+
+protected:
+    void check_session() {
+        if (!_open)
+            throw std::logic_error("Vendor session is closed");
+        ++_calls;
+    }
+
+    static Reply convert(Request request) { return request * 9 / 5 + 32'000; }
+
+    std::mutex _mutex;
+    bool _open = true;
+    std::uint64_t _calls = 0;
+};
+
+
+// Newer version of the vendor API, with a bulk call
+class BulkAdaptee : public Adaptee {
+public:
+    [[gnu::noinline]] void do_logic_another_way_bulk(std::span<const Request> requests, std::span<Reply> replies) {
+        std::lock_guard lock(_mutex);
+        check_session();
+        std::transform(requests.begin(), requests.end(), replies.begin(), convert);
+    }
+};
+
+
+template <typename T>
+concept HasBulkApi = requires(T& adaptee, std::span<const Request> requests, std::span<Reply> replies) {
+    adaptee.do_logic_another_way_bulk(requests, replies);
+};
+
+
+class Target {
+public:
+    virtual ~Target() = default;
+    virtual Reply do_logic(Request request) = 0;
+};
+
+
+// Adapter from Adapter.cpp, one vendor call per request
+template <typename Adaptee>
+class ObjectAdapter : public Target {
+public:
+    explicit ObjectAdapter(Adaptee* adaptee)
+        : _adaptee(adaptee) {}
+
+    Reply do_logic(Request request) override { return _adaptee->do_logic_another_way(request); }
+
+private:
+    Adaptee* _adaptee;
+};
+
+
+class BatchTarget {
+public:
+    virtual ~BatchTarget() = default;
+
+    // replies must be at least as long as requests
+    virtual void do_logic(std::span<const Request> requests, std::span<Reply> replies) = 0;
+};
+
+
+// One virtual call per batch, and one vendor call per batch if the adaptee has a bulk API
+template <typename Adaptee>
+class BatchAdapter : public BatchTarget {
+public:
+    explicit BatchAdapter(Adaptee* adaptee)
+        : _adaptee(adaptee) {}
+
+    void do_logic(std::span<const Request> requests, std::span<Reply> replies) override {
+        if (replies.size() < requests.size())
+            throw std::invalid_argument("Not enough space for replies");
+
+        if constexpr (HasBulkApi<Adaptee>) {
+            _adaptee->do_logic_another_way_bulk(requests, replies.first(requests.size()));
+        }
+        else {
+            for (std::size_t i = 0; i < requests.size(); ++i)
+                replies[i] = _adaptee->do_logic_another_way(requests[i]);
+        }
+    }
+
+private:
+    Adaptee* _adaptee;
+};
+
+
+void client() {
+    BulkAdaptee adaptee;
+    std::vector<Request> requests{0, 100'000, -40'000};
+    std::vector<Reply> replies(requests.size());
+
+    ObjectAdapter<BulkAdaptee> single{&adaptee};
+    for (Request request: requests)
+        std::cout << single.do_logic(request) << ' ';
+    std::cout << "| vendor calls: " << adaptee.calls() << '\n';
+
+    BatchAdapter<BulkAdaptee> batch{&adaptee};
+    batch.do_logic(requests, replies);
+    for (Reply reply: replies)
+        std::cout << reply << ' ';
+    std::cout << "| vendor calls: " << adaptee.calls() << '\n';
+
+    // Old vendor API, the adapter loops
+    Adaptee old_adaptee;
+    BatchAdapter<Adaptee> fallback{&old_adaptee};
+    fallback.do_logic(requests, replies);
+    for (Reply reply: replies)
+        std::cout << reply << ' ';
+    std::cout << "| vendor calls: " << old_adaptee.calls() << '\n';
+
+    // 32000 212000 -40000 | vendor calls: 3
+    // 32000 212000 -40000 | vendor calls: 4
+    // 32000 212000 -40000 | vendor calls: 3
+}
+
+
+void benchmark() {
+    constexpr std::size_t total = 10'000'000;
+
+    std::vector<Request> requests(total);
+    for (std::size_t i = 0; i < total; ++i)
+        requests[i] = static_cast<Request>(i % 200'000) - 100'000;
+    std::vector<Reply> replies(total);
+
+    auto report = [&](const char* name, std::size_t batch, std::chrono::duration<double> elapsed) {
+        Reply sum = 0;
+        for (Reply reply: replies)
+            sum += reply;
+        std::cout << name << "  |  batch: " << std::setw(4) << batch << "  |  ns/request: " << elapsed.count() * 1e9 / total
+                  << "  |  checksum: " << sum << '\n';
+    };
+
+    std::cout << "\n" << total << " requests" << '\n';
+
+    {
+        BulkAdaptee adaptee;
+        std::unique_ptr<Target> target = std::make_unique<ObjectAdapter<BulkAdaptee>>(&adaptee);
+        auto begin = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < total; ++i)
+            replies[i] = target->do_logic(requests[i]);
+        report("one call per request", 1, std::chrono::steady_clock::now() - begin);
+    }
+
+    auto run_batches = [&](const char* name, BatchTarget& target, std::size_t batch) {
+        std::span<const Request> all_requests{requests};
+        std::span<Reply> all_replies{replies};
+        auto begin = std::chrono::steady_clock::now();
+        for (std::size_t offset = 0; offset < total; offset += batch) {
+            std::size_t size = std::min(batch, total - offset);
+            target.do_logic(all_requests.subspan(offset, size), all_replies.subspan(offset, size));
+        }
+        report(name, batch, std::chrono::steady_clock::now() - begin);
+    };
+
+    for (std::size_t batch: {1, 4, 16, 64, 256, 1024}) {
+        Adaptee adaptee;
+        std::unique_ptr<BatchTarget> target = std::make_unique<BatchAdapter<Adaptee>>(&adaptee);
+        run_batches("looping fallback    ", *target, batch);
+    }
+
+    for (std::size_t batch: {1, 4, 16, 64, 256, 1024}) {
+        BulkAdaptee adaptee;
+        std::unique_ptr<BatchTarget> target = std::make_unique<BatchAdapter<BulkAdaptee>>(&adaptee);
+        run_batches("bulk vendor call    ", *target, batch);
+    }
+}
+
+
+int main() {
+    client();
+    benchmark();
+
+    return 0;
+}
@@ -0,0 +1,340 @@
+/*
+ * Adapter pattern: static and type-erased adapters
+ *
+ * Intent: same as in Adapter.cpp, objects with incompatible interfaces work together.
+ * ObjectAdapter there is a virtual Target holding a pointer to its Adaptee, so every call is
+ * an indirect call through two pointers, which the compiler can't inline. StaticAdapter maps
+ * a member function of Adaptee to Target interface at compile time, code written against
+ * the TargetLike concept calls the adaptee directly. AnyTarget keeps any TargetLike object
+ * in a small inline buffer, for collections of different adapters without a heap object each.
+ */
+
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+template <typename T>
+concept TargetLike = requires(T& target) {
+    { target.do_logic() } -> std::convertible_to<std::uint64_t>;
+};
+
+
+class Adaptee {
+public:
+    explicit Adaptee(std::uint64_t value)
+        : _value(value) {}
+
+    std::uint64_t do_logic_another_way() const { return _value * 3 + 1; }
+
+private:
+    std::uint64_t _value;
+};
+
+
+// Another vendor, another interface
+class OtherAdaptee {
+public:
+    explicit OtherAdaptee(std::uint32_t value)
+        : _value(value) {}
+
+    std::uint32_t do_logic_yet_another_way() const { return _value ^ 0x5bd1e995u; }
+
+private:
+    std::uint32_t _value;
+};
+
+
+// Adapters from Adapter.cpp, with results to sum
+namespace classic {
+
+class Target {
+public:
+    virtual ~Target() = default;
+    virtual std::uint64_t do_logic() = 0;
+};
+
+
+template <typename Adaptee, auto Method>
+class ObjectAdapter : public Target {
+public:
+    explicit ObjectAdapter(Adaptee* adaptee)
+        : _adaptee(adaptee) {}
+
+    std::uint64_t do_logic() override { return std::invoke(Method, *_adaptee); }
+
+private:
+    Adaptee* _adaptee;
+};
+
+}
+
+
+// Keeps the adaptee by value like ClassAdapter, but without inheritance and virtual calls
+template <typename Adaptee, auto Method>
+requires std::invocable<decltype(Method), const Adaptee&>
+class StaticAdapter {
+public:
+    explicit StaticAdapter(Adaptee adaptee)
+        : _adaptee(std::move(adaptee)) {}
+
+    std::uint64_t do_logic() const { return std::invoke(Method, _adaptee); }
+
+private:
+    Adaptee _adaptee;
+};
+
+using AdapteeAdapter = StaticAdapter<Adaptee, &Adaptee::do_logic_another_way>;
+using OtherAdapteeAdapter = StaticAdapter<OtherAdaptee, &OtherAdaptee::do_logic_yet_another_way>;
+
+static_assert(TargetLike<AdapteeAdapter> && TargetLike<OtherAdapteeAdapter>);
+static_assert(sizeof(AdapteeAdapter) == sizeof(Adaptee));
+
+
+// Holds any TargetLike object. Objects up to `buffer_size` bytes which can be moved without
+// exceptions live inside AnyTarget, bigger ones on the heap.
+class AnyTarget {
+public:
+    static constexpr std::size_t buffer_size = 16;
+
+    template <TargetLike T>
+    requires (!std::same_as<std::decay_t<T>, AnyTarget>)
+    AnyTarget(T&& target)
+        : _operations(&operations_for<std::decay_t<T>>) {
+        using Stored = std::decay_t<T>;
+        if constexpr (is_inline<Stored>)
+            ::new (static_cast<void*>(_buffer)) Stored(std::forward<T>(target));
+        else
+            _heap = new Stored(std::forward<T>(target));
+    }
+
+    AnyTarget(const AnyTarget& other)
+        : _operations(other._operations) {
+        _operations->copy(other, *this);
+    }
+
+    AnyTarget(AnyTarget&& other) noexcept
+        : _operations(other._operations) {
+        _operations->move(other, *this);
+    }
+
+    AnyTarget& operator=(AnyTarget other) noexcept {
+        _operations->destroy(*this);
+        _operations = other._operations;
+        _operations->move(other, *this);
+        return *this;
+    }
+
+    ~AnyTarget() { _operations->destroy(*this); }
+
+    std::uint64_t do_logic() { return _operations->do_logic(*this); }
+
+private:
+    struct Operations;
+
+    // Declared before the tables below, their initializers use these members
+    const Operations* _operations;
+    union {
+        alignas(std::max_align_t) std::byte _buffer[buffer_size];
+        void* _heap;
+    };
+
+    template <typename T>
+    static constexpr bool is_inline = sizeof(T) <= buffer_size && alignof(T) <= alignof(std::max_align_t)
+                                      && std::is_nothrow_move_constructible_v<T>;
+
+    // One table per stored type, like a vtable but only for AnyTarget
+    struct Operations {
+        std::uint64_t (*do_logic)(AnyTarget&);
+        void (*copy)(const AnyTarget& from, AnyTarget& to);
+        void (*move)(AnyTarget& from, AnyTarget& to) noexcept;
+        void (*destroy)(AnyTarget&) noexcept;
+    };
+
+    template <typename T>
+    static T& stored(AnyTarget& any) {
+        if constexpr (is_inline<T>)
+            return *std::launder(reinterpret_cast<T*>(any._buffer));
+        else
+            return *static_cast<T*>(any._heap);
+    }
+
+    template <typename T>
+    static const T& stored(const AnyTarget& any) { return stored<T>(const_cast<AnyTarget&>(any)); }
+
+    template <typename T>
+    static constexpr Operations operations_for{
+        [](AnyTarget& any) -> std::uint64_t { return stored<T>(any).do_logic(); },
+        [](const AnyTarget& from, AnyTarget& to) {
+            if constexpr (is_inline<T>)
+                ::new (static_cast<void*>(to._buffer)) T(stored<T>(from));
+            else
+                to._heap = new T(stored<T>(from));
+        },
+        [](AnyTarget& from, AnyTarget& to) noexcept {
+            if constexpr (is_inline<T>)
+                ::new (static_cast<void*>(to._buffer)) T(std::move(stored<T>(from)));
+            else
+                to._heap = std::exchange(from._heap, nullptr);
+        },
+        [](AnyTarget& any) noexcept {
+            if constexpr (is_inline<T>)
+                stored<T>(any).~T();
+            else
+                delete static_cast<T*>(any._heap);
+        },
+    };
+};
+
+
+// Works with any adapter, for StaticAdapter the call is inlined into the loop
+template <TargetLike T>
+std::uint64_t run_all(std::vector<T>& targets) {
+    std::uint64_t sum = 0;
+    for (auto& target: targets)
+        sum += target.do_logic();
+    return sum;
+}
+
+
+template <typename T>
+void do_not_optimize(const T& value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+
+void client() {
+    Adaptee adaptee{1};
+    OtherAdaptee other{2};
+
+    classic::ObjectAdapter<Adaptee, &Adaptee::do_logic_another_way> object_adapter{&adaptee};
+    classic::Target& target = object_adapter;
+    std::cout << "virtual: " << target.do_logic() << '\n';
+
+    AdapteeAdapter static_adapter{adaptee};
+    std::cout << "static: " << static_adapter.do_logic() << '\n';
+
+    // Different adapters in one collection, all of them inside the buffers
+    std::vector<AnyTarget> targets;
+    targets.emplace_back(AdapteeAdapter{adaptee});
+    targets.emplace_back(OtherAdapteeAdapter{other});
+    for (auto& any: targets)
+        std::cout << "type-erased: " << any.do_logic() << '\n';
+
+    // virtual: 4
+    // static: 4
+    // type-erased: 4
+    // type-erased: 1540483479
+}
+
+
+void benchmark() {
+    constexpr std::size_t objects = 10'000'000;
+    constexpr int repeats = 5;
+
+    std::vector<Adaptee> adaptees;
+    std::vector<OtherAdaptee> others;
+    adaptees.reserve(objects);
+    others.reserve(objects);
+    for (std::size_t i = 0; i < objects; ++i) {
+        adaptees.emplace_back(i);
+        others.emplace_back(static_cast<std::uint32_t>(i));
+    }
+
+    auto report = [](const char* name, std::chrono::duration<double> elapsed, std::uint64_t sum) {
+        std::cout << name << "  |  ns/call: " << elapsed.count() * 1e9 / (objects * repeats)
+                  << "  |  sum: " << sum << '\n';
+    };
+
+    auto measure = [&](const char* name, auto&& run) {
+        std::uint64_t sum = run();   // warm up
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeats; ++i) {
+            sum = run();
+            do_not_optimize(sum);
+        }
+        report(name, std::chrono::steady_clock::now() - begin, sum);
+    };
+
+    std::cout << "\none adaptee type, " << objects << " adapted objects" << '\n';
+    {
+        std::vector<std::unique_ptr<classic::Target>> targets;
+        targets.reserve(objects);
+        for (auto& adaptee: adaptees)
+            targets.push_back(std::make_unique<classic::ObjectAdapter<Adaptee, &Adaptee::do_logic_another_way>>(&adaptee));
+        measure("virtual      ", [&] {
+            std::uint64_t sum = 0;
+            for (auto& target: targets)
+                sum += target->do_logic();
+            return sum;
+        });
+    }
+    {
+        std::vector<AdapteeAdapter> targets(adaptees.begin(), adaptees.end());
+        measure("static       ", [&] { return run_all(targets); });
+    }
+    {
+        std::vector<AnyTarget> targets;
+        targets.reserve(objects);
+        for (auto& adaptee: adaptees)
+            targets.emplace_back(AdapteeAdapter{adaptee});
+        measure("type-erased  ", [&] { return run_all(targets); });
+    }
+
+    // Static adapters can't share one collection, so each type goes in its own vector
+    std::cout << "\ntwo adaptee types interleaved, " << objects << " adapted objects" << '\n';
+    {
+        std::vector<std::unique_ptr<classic::Target>> targets;
+        targets.reserve(objects);
+        for (std::size_t i = 0; i < objects; ++i) {
+            if (i % 2 == 0)
+                targets.push_back(std::make_unique<classic::ObjectAdapter<Adaptee, &Adaptee::do_logic_another_way>>(&adaptees[i]));
+            else
+                targets.push_back(std::make_unique<classic::ObjectAdapter<OtherAdaptee, &OtherAdaptee::do_logic_yet_another_way>>(&others[i]));
+        }
+        measure("virtual      ", [&] {
+            std::uint64_t sum = 0;
+            for (auto& target: targets)
+                sum += target->do_logic();
+            return sum;
+        });
+    }
+    {
+        std::vector<AdapteeAdapter> first;
+        std::vector<OtherAdapteeAdapter> second;
+        for (std::size_t i = 0; i < objects; ++i) {
+            if (i % 2 == 0)
+                first.emplace_back(adaptees[i]);
+            else
+                second.emplace_back(others[i]);
+        }
+        measure("static       ", [&] { return run_all(first) + run_all(second); });
+    }
+    {
+        std::vector<AnyTarget> targets;
+        targets.reserve(objects);
+        for (std::size_t i = 0; i < objects; ++i) {
+            if (i % 2 == 0)
+                targets.emplace_back(AdapteeAdapter{adaptees[i]});
+            else
+                targets.emplace_back(OtherAdapteeAdapter{others[i]});
+        }
+        measure("type-erased  ", [&] { return run_all(targets); });
+    }
+}
+
+
+int main() {
+    client();
+    benchmark();
+
+    return 0;
+}
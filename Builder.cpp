@@ -48,12 +48,21 @@ public:
     explicit CarBuilder(const std::string& name = "undefined")
         : car(name) {}
 
-    CarBuilder set_name(const std::string& name)    { car.name = name; return *this; }
-    CarBuilder set_engine(const Engine& engine)     { car.engine = engine; return *this;}
-    CarBuilder set_owner(const std::string& owner)  { car.owner = owner; return *this; }
-    CarBuilder set_mileage(unsigned int mileage)    { car.mileage = mileage; return *this; }
-
-    Car get_car() { return car; }
+    // Setters chain by reference, so nothing is copied between calls. Arguments are taken
+    // by value and moved in: temporaries are moved all the way into the car.
+    CarBuilder& set_name(std::string name) &        { car.name = std::move(name); return *this; }
+    CarBuilder& set_engine(Engine engine) &         { car.engine = std::move(engine); return *this; }
+    CarBuilder& set_owner(std::string owner) &      { car.owner = std::move(owner); return *this; }
+    CarBuilder& set_mileage(unsigned int mileage) & { car.mileage = mileage; return *this; }
+
+    // Same for a temporary builder: CarBuilder{"BMW"}.set_owner("Alex").get_car()
+    CarBuilder&& set_name(std::string name) &&        { return std::move(set_name(std::move(name))); }
+    CarBuilder&& set_engine(Engine engine) &&         { return std::move(set_engine(std::move(engine))); }
+    CarBuilder&& set_owner(std::string owner) &&      { return std::move(set_owner(std::move(owner))); }
+    CarBuilder&& set_mileage(unsigned int mileage) && { return std::move(set_mileage(mileage)); }
+
+    Car get_car() const& { return car; }
+    Car get_car() &&     { return std::move(car); }
 
 private:
     Car car;
@@ -81,7 +90,10 @@ int main() {
 
     std::cout << bmw;       // Name: BMW  |  Engine: 3  |  Owner: Vladislav  |  Mileage:10000
     std::cout << mercedes;  // Name: Mercedes  |  Engine: 2  |  Owner: Alex  |  Mileage:15000
-    std::cout << kia;       // Name: Kia  |  Engine: 3  |  Owner: Stan  |  Mileage:50000
+    std::cout << kia;       // Name: Kia  |  Engine: 2  |  Owner: Stan  |  Mileage:50000
+
+    Car audi        = CarBuilder{"Audi"}.set_owner("Ivan").set_mileage(100).get_car();
+    std::cout << audi;      // Name: Audi  |  Engine: 1  |  Owner: Ivan  |  Mileage:100
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,258 @@
+//
+// Builder that builds cars in place, in caller-provided or arena storage
+//
+// The old CarBuilder returned itself by value from every setter, so each chained call
+// copied the whole car, and get_car() copied it once more. This builder holds a reference
+// to the car being built: setters write straight into it and nothing is copied.
+// Cars use polymorphic allocators, so a car placed into an arena keeps its strings there too.
+//
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "HeapUsage.h"
+
+struct Engine {
+public:
+    enum Type { Undefined, Slow, Medium, Fast };
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+public:
+    explicit Engine(allocator_type allocator = {})
+        : manufacturer(allocator), type(Slow) {}
+
+    explicit Engine(std::string_view manufacture, Type type = Undefined, allocator_type allocator = {})
+        : manufacturer(manufacture, allocator), type(type) {}
+
+    Engine(const Engine& other, allocator_type allocator)
+        : manufacturer(other.manufacturer, allocator), type(other.type) {}
+
+    Engine(Engine&& other, allocator_type allocator)
+        : manufacturer(std::move(other.manufacturer), allocator), type(other.type) {}
+
+    Engine(const Engine&) = default;
+    Engine(Engine&&) = default;
+    Engine& operator=(const Engine&) = default;
+    Engine& operator=(Engine&&) = default;
+
+    std::pmr::string manufacturer;
+    Type type;
+};
+
+
+class CarBuilder;
+
+
+class Car {
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    explicit Car(std::string_view name, allocator_type allocator = {})
+        : name(name, allocator), engine(allocator), owner(allocator), mileage(0) {}
+
+    Car(const Car& other, allocator_type allocator)
+        : name(other.name, allocator), engine(other.engine, allocator),
+          owner(other.owner, allocator), mileage(other.mileage) {}
+
+    Car(Car&& other, allocator_type allocator)
+        : name(std::move(other.name), allocator), engine(std::move(other.engine), allocator),
+          owner(std::move(other.owner), allocator), mileage(other.mileage) {}
+
+    Car(const Car&) = default;
+    Car(Car&&) = default;
+    Car& operator=(const Car&) = default;
+    Car& operator=(Car&&) = default;
+
+public:
+    friend class CarBuilder;
+    friend std::ostream &operator <<(std::ostream &output, const Car& car);
+
+private:
+    std::pmr::string name;
+    Engine engine;
+    std::pmr::string owner;
+    unsigned int mileage;
+};
+
+
+// Builder fills the car it was given. Strings are copied once, straight into the memory
+// of the car (arena for arena cars), there are no intermediate copies.
+class CarBuilder {
+public:
+    explicit CarBuilder(Car& car)
+        : car(car) {}
+
+    CarBuilder& set_name(std::string_view name) &           { car.name = name; return *this; }
+    CarBuilder& set_engine(const Engine& engine) &          { car.engine = engine; return *this; }
+    CarBuilder& set_owner(std::string_view owner) &         { car.owner = owner; return *this; }
+    CarBuilder& set_mileage(unsigned int mileage) &         { car.mileage = mileage; return *this; }
+
+    CarBuilder&& set_name(std::string_view name) &&         { return std::move(set_name(name)); }
+    CarBuilder&& set_engine(const Engine& engine) &&        { return std::move(set_engine(engine)); }
+    CarBuilder&& set_owner(std::string_view owner) &&       { return std::move(set_owner(owner)); }
+    CarBuilder&& set_mileage(unsigned int mileage) &&       { return std::move(set_mileage(mileage)); }
+
+    Car& get_car() const { return car; }
+
+private:
+    Car& car;
+};
+
+
+std::ostream &operator<<(std::ostream &output, const Car &car) {
+    output << "Name: " << car.name << "  |  "
+           << "Engine: " << car.engine.type << "  |  "
+           << "Owner: " << car.owner << "  |  "
+           << "Mileage:" << car.mileage << '\n';
+
+    return output;
+}
+
+
+// Builder from Builder.cpp before it chained by reference, used as baseline
+namespace baseline {
+
+struct Engine {
+    enum Type { Undefined, Slow, Medium, Fast };
+
+    Engine() : type(Slow) {}
+    explicit Engine(std::string manufacture, Type type = Undefined)
+        : manufacturer(std::move(manufacture)), type(type) {}
+
+    std::string manufacturer;
+    Type type;
+};
+
+class CarBuilder;
+
+class Car {
+public:
+    Car(std::string name) : name(std::move(name)), mileage(0) {}
+
+    friend class CarBuilder;
+
+private:
+    std::string name;
+    Engine engine;
+    std::string owner;
+    unsigned int mileage;
+};
+
+class CarBuilder {
+public:
+    explicit CarBuilder(const std::string& name = "undefined") : car(name) {}
+
+    CarBuilder set_name(const std::string& name)    { car.name = name; return *this; }
+    CarBuilder set_engine(const Engine& engine)     { car.engine = engine; return *this;}
+    CarBuilder set_owner(const std::string& owner)  { car.owner = owner; return *this; }
+    CarBuilder set_mileage(unsigned int mileage)    { car.mileage = mileage; return *this; }
+
+    Car get_car() { return car; }
+
+private:
+    Car car;
+};
+
+}   // namespace baseline
+
+
+void client() {
+    Engine bmw_engine{"BMW", Engine::Fast};
+
+    // Caller-provided storage
+    Car bmw{"BMW"};
+    CarBuilder{bmw}.set_engine(bmw_engine).set_mileage(10000).set_owner("Vladislav");
+    std::cout << bmw;   // Name: BMW  |  Engine: 3  |  Owner: Vladislav  |  Mileage:10000
+
+    // Arena storage: the cars and all their strings live in one buffer
+    std::pmr::monotonic_buffer_resource arena;
+    std::pmr::vector<Car> cars{&arena};
+
+    CarBuilder builder{cars.emplace_back("Mercedes")};
+    builder.set_owner("Alex").set_mileage(15000).set_engine(Engine{"Mercedes", Engine::Medium});
+
+    CarBuilder{cars.emplace_back("Kia")}.set_owner("Stan").set_mileage(50000);
+
+    for (const auto& car: cars)
+        std::cout << car;
+    // Name: Mercedes  |  Engine: 2  |  Owner: Alex  |  Mileage:15000
+    // Name: Kia  |  Engine: 1  |  Owner: Stan  |  Mileage:50000
+}
+
+
+void benchmark() {
+    constexpr std::size_t cars_count = 1'000'000;
+
+    // Long enough to not fit into small string buffer
+    const std::string name = "BMW M5 Competition xDrive";
+    const std::string owner = "Vladislav Kirpichov-Ivanov";
+    const std::string manufacturer = "Bayerische Motoren Werke AG";
+
+    std::cout << "\nbuilding " << cars_count << " cars" << '\n';
+
+    {
+        baseline::Engine engine{manufacturer, baseline::Engine::Fast};
+        std::vector<baseline::Car> cars;
+        cars.reserve(cars_count);
+
+        std::size_t before = heap_usage::allocations();
+        auto begin = std::chrono::steady_clock::now();
+
+        for (std::size_t i = 0; i < cars_count; ++i)
+            cars.push_back(baseline::CarBuilder{name}.set_engine(engine).set_owner(owner).set_mileage(i).get_car());
+
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - begin;
+        std::cout << "by value builder, vector         |  allocations/car: "
+                  << static_cast<double>(heap_usage::allocations() - before) / cars_count
+                  << "  |  ns/car: " << elapsed.count() / cars_count << '\n';
+    }
+
+    {
+        Engine engine{manufacturer, Engine::Fast};
+        std::vector<Car> cars;
+        cars.reserve(cars_count);
+
+        std::size_t before = heap_usage::allocations();
+        auto begin = std::chrono::steady_clock::now();
+
+        for (std::size_t i = 0; i < cars_count; ++i)
+            CarBuilder{cars.emplace_back(name)}.set_engine(engine).set_owner(owner).set_mileage(i);
+
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - begin;
+        std::cout << "in place builder, vector         |  allocations/car: "
+                  << static_cast<double>(heap_usage::allocations() - before) / cars_count
+                  << "  |  ns/car: " << elapsed.count() / cars_count << '\n';
+    }
+
+    {
+        std::pmr::monotonic_buffer_resource arena{cars_count * 256};
+        Engine engine{manufacturer, Engine::Fast, &arena};
+        std::pmr::vector<Car> cars{&arena};
+        cars.reserve(cars_count);
+
+        std::size_t before = heap_usage::allocations();
+        auto begin = std::chrono::steady_clock::now();
+
+        for (std::size_t i = 0; i < cars_count; ++i)
+            CarBuilder{cars.emplace_back(name)}.set_engine(engine).set_owner(owner).set_mileage(i);
+
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - begin;
+        std::cout << "in place builder, arena          |  allocations/car: "
+                  << static_cast<double>(heap_usage::allocations() - before) / cars_count
+                  << "  |  ns/car: " << elapsed.count() / cars_count << '\n';
+    }
+}
+
+
+int main() {
+    client();
+    benchmark();
+
+    return 0;
+}
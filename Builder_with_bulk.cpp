@@ -0,0 +1,381 @@
+//
+// Bulk construction of cars from columnar input
+//
+// Feed data comes as columns: names, owners, engines and mileages. Instead of running
+// CarBuilder once per row, BulkCarBuilder constructs cars directly into one uninitialized
+// block, splitting rows between threads. Manufacturers repeat a lot ("BMW", "Kia", ...),
+// so they are interned: every car keeps a view of one shared string. Short names and
+// owners fit into the small string buffer of std::string and don't allocate at all.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+// Stores one copy of every string. Returned views are valid while the pool is alive.
+// Safe to use from several threads.
+class StringPool {
+public:
+    std::string_view intern(std::string_view value) {
+        {
+            std::shared_lock lock(_mutex);
+            auto found = _index.find(value);
+            if (found != _index.end())
+                return found->second;
+        }
+
+        std::unique_lock lock(_mutex);
+        auto found = _index.find(value);
+        if (found != _index.end())
+            return found->second;
+
+        std::string_view stored = _strings.emplace_back(value);
+        _index.emplace(stored, stored);
+        return stored;
+    }
+
+    std::size_t size() const {
+        std::shared_lock lock(_mutex);
+        return _strings.size();
+    }
+
+private:
+    mutable std::shared_mutex _mutex;
+    std::deque<std::string> _strings;   // deque doesn't move elements, views stay valid
+    std::unordered_map<std::string_view, std::string_view> _index;
+};
+
+
+struct Engine {
+public:
+    enum Type { Undefined, Slow, Medium, Fast };
+
+public:
+    Engine()
+        : type(Slow) {}
+
+    // Manufacturer must outlive the engine, normally it is interned in a StringPool
+    explicit Engine(std::string_view manufacture, Type type = Undefined)
+        : manufacturer(manufacture), type(type) {}
+
+    std::string_view manufacturer;
+    Type type;
+};
+
+
+class CarBuilder;
+class BulkCarBuilder;
+
+
+class Car {
+public:
+    Car() : mileage(0) {}
+    Car(std::string name)
+        : name(std::move(name)), mileage(0) {}
+
+public:
+    friend class CarBuilder;
+    friend class BulkCarBuilder;
+    friend std::ostream &operator <<(std::ostream &output, const Car& car);
+
+private:
+    std::string name;
+    Engine engine;
+    std::string owner;
+    unsigned int mileage;
+};
+
+
+std::ostream &operator<<(std::ostream &output, const Car &car) {
+    output << "Name: " << car.name << "  |  "
+           << "Engine: " << car.engine.type << " by " << car.engine.manufacturer << "  |  "
+           << "Owner: " << car.owner << "  |  "
+           << "Mileage:" << car.mileage << '\n';
+
+    return output;
+}
+
+
+// Column i of every span describes car i
+struct CarColumns {
+    std::span<const std::string_view> names;
+    std::span<const std::string_view> owners;
+    std::span<const std::string_view> manufacturers;
+    std::span<const Engine::Type> engine_types;
+    std::span<const unsigned int> mileages;
+
+    std::size_t rows() const { return names.size(); }
+};
+
+
+// Cars built by one BulkCarBuilder::build() call
+class CarBlock {
+public:
+    CarBlock() = default;
+
+    CarBlock(CarBlock&& other) noexcept
+        : _cars(std::exchange(other._cars, nullptr)), _size(std::exchange(other._size, 0)),
+          _capacity(std::exchange(other._capacity, 0)) {}
+
+    CarBlock& operator=(CarBlock other) noexcept {
+        std::swap(_cars, other._cars);
+        std::swap(_size, other._size);
+        std::swap(_capacity, other._capacity);
+        return *this;
+    }
+
+    ~CarBlock() {
+        std::destroy_n(_cars, _size);
+        std::allocator<Car>{}.deallocate(_cars, _capacity);
+    }
+
+    std::size_t size() const { return _size; }
+    const Car& operator[](std::size_t index) const { return _cars[index]; }
+
+    const Car* begin() const { return _cars; }
+    const Car* end() const { return _cars + _size; }
+
+private:
+    friend class BulkCarBuilder;
+
+    // Storage only, cars are constructed by the builder
+    explicit CarBlock(std::size_t capacity)
+        : _cars(std::allocator<Car>{}.allocate(capacity)), _capacity(capacity) {}
+
+    Car* _cars = nullptr;
+    std::size_t _size = 0;
+    std::size_t _capacity = 0;
+};
+
+
+class BulkCarBuilder {
+public:
+    explicit BulkCarBuilder(StringPool& pool, unsigned threads = std::thread::hardware_concurrency())
+        : _pool(pool), _threads(std::max(threads, 1u)) {}
+
+    // One car per row. Every thread constructs the cars of its rows in place, so memory
+    // of the block is first touched in parallel and no car is default-constructed before.
+    CarBlock build(const CarColumns& columns) const {
+        std::size_t rows = columns.rows();
+        if (columns.owners.size() != rows || columns.manufacturers.size() != rows ||
+            columns.engine_types.size() != rows || columns.mileages.size() != rows)
+            throw std::invalid_argument("Columns have different length");
+
+        CarBlock block{rows};
+        std::size_t chunk = std::max<std::size_t>((rows + _threads - 1) / _threads, 1);
+        std::size_t chunks = (rows + chunk - 1) / chunk;
+
+        // Chunk without an error is fully constructed, chunk with one has no cars
+        std::vector<std::exception_ptr> errors(chunks);
+        auto work = [&](std::size_t i) {
+            try {
+                build_rows(columns, i * chunk, std::min((i + 1) * chunk, rows), block._cars);
+            }
+            catch (...) {
+                errors[i] = std::current_exception();
+            }
+        };
+
+        {
+            std::vector<std::jthread> workers;
+            for (std::size_t i = 1; i < chunks; ++i) {
+                try {
+                    workers.emplace_back(work, i);
+                }
+                catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            }
+
+            // First chunk is built by the calling thread
+            if (chunks != 0)
+                work(0);
+        }
+
+        auto failed = std::find_if(errors.begin(), errors.end(), [](const auto& error) { return error != nullptr; });
+        if (failed != errors.end()) {
+            for (std::size_t i = 0; i < chunks; ++i) {
+                if (!errors[i])
+                    std::destroy(block._cars + i * chunk, block._cars + std::min((i + 1) * chunk, rows));
+            }
+            std::rethrow_exception(*failed);
+        }
+
+        block._size = rows;
+        return block;
+    }
+
+private:
+    // Constructs cars[begin, end). If it throws, cars it has constructed are destroyed.
+    void build_rows(const CarColumns& columns, std::size_t begin, std::size_t end, Car* cars) const {
+        // Manufacturers repeat, so most of them are found in this small cache without locking the pool
+        std::unordered_map<std::string_view, std::string_view> interned;
+
+        std::size_t constructed = begin;
+        try {
+            for (std::size_t row = begin; row < end; ++row) {
+                std::string_view manufacturer = columns.manufacturers[row];
+                auto found = interned.find(manufacturer);
+                if (found == interned.end())
+                    found = interned.emplace(manufacturer, _pool.intern(manufacturer)).first;
+
+                Car* car = ::new (static_cast<void*>(cars + row)) Car(std::string(columns.names[row]));
+                constructed = row + 1;
+                car->owner = columns.owners[row];
+                car->mileage = columns.mileages[row];
+                car->engine = Engine{found->second, columns.engine_types[row]};
+            }
+        }
+        catch (...) {
+            std::destroy(cars + begin, cars + constructed);
+            throw;
+        }
+    }
+
+    StringPool& _pool;
+    unsigned _threads;
+};
+
+
+// Builder from Builder.cpp, one car at a time
+class CarBuilder {
+public:
+    explicit CarBuilder(const std::string& name = "undefined")
+        : car(name) {}
+
+    CarBuilder& set_name(std::string name) &        { car.name = std::move(name); return *this; }
+    CarBuilder& set_engine(Engine engine) &         { car.engine = engine; return *this; }
+    CarBuilder& set_owner(std::string owner) &      { car.owner = std::move(owner); return *this; }
+    CarBuilder& set_mileage(unsigned int mileage) & { car.mileage = mileage; return *this; }
+
+    CarBuilder&& set_name(std::string name) &&        { return std::move(set_name(std::move(name))); }
+    CarBuilder&& set_engine(Engine engine) &&         { return std::move(set_engine(engine)); }
+    CarBuilder&& set_owner(std::string owner) &&      { return std::move(set_owner(std::move(owner))); }
+    CarBuilder&& set_mileage(unsigned int mileage) && { return std::move(set_mileage(mileage)); }
+
+    Car get_car() const& { return car; }
+    Car get_car() &&     { return std::move(car); }
+
+private:
+    Car car;
+};
+
+
+// Feed data, all strings are views into `text`
+struct Feed {
+    explicit Feed(std::size_t rows) {
+        static constexpr std::string_view models[] = {"X5", "E-Class", "Rio", "A4", "Model 3", "Camry"};
+        static constexpr std::string_view brands[] = {"BMW", "Mercedes", "Kia", "Audi", "Tesla", "Toyota"};
+
+        text.reserve(rows * 16);
+        std::vector<std::size_t> owner_offsets;
+        owner_offsets.reserve(rows + 1);
+        for (std::size_t i = 0; i < rows; ++i) {
+            owner_offsets.push_back(text.size());
+            text += "Owner ";
+            text += std::to_string(i);
+        }
+        owner_offsets.push_back(text.size());
+
+        names.reserve(rows);
+        owners.reserve(rows);
+        manufacturers.reserve(rows);
+        types.reserve(rows);
+        mileages.reserve(rows);
+
+        for (std::size_t i = 0; i < rows; ++i) {
+            names.push_back(models[i % 6]);
+            owners.push_back(std::string_view(text).substr(owner_offsets[i], owner_offsets[i + 1] - owner_offsets[i]));
+            manufacturers.push_back(brands[i % 6]);
+            types.push_back(static_cast<Engine::Type>(i % 4));
+            mileages.push_back(static_cast<unsigned int>(i * 7 % 300'000));
+        }
+    }
+
+    CarColumns columns() const { return {names, owners, manufacturers, types, mileages}; }
+
+    std::string text;
+    std::vector<std::string_view> names;
+    std::vector<std::string_view> owners;
+    std::vector<std::string_view> manufacturers;
+    std::vector<Engine::Type> types;
+    std::vector<unsigned int> mileages;
+};
+
+
+void client() {
+    Feed feed{3};
+    StringPool pool;
+
+    CarBlock cars = BulkCarBuilder{pool}.build(feed.columns());
+
+    for (const auto& car: cars)
+        std::cout << car;
+
+    //  Name: X5  |  Engine: 0 by BMW  |  Owner: Owner 0  |  Mileage:0
+    //  Name: E-Class  |  Engine: 1 by Mercedes  |  Owner: Owner 1  |  Mileage:7
+    //  Name: Rio  |  Engine: 2 by Kia  |  Owner: Owner 2  |  Mileage:14
+}
+
+
+void benchmark() {
+    constexpr std::size_t rows = 10'000'000;
+
+    Feed feed{rows};
+    CarColumns columns = feed.columns();
+
+    std::cout << "\nbuilding " << rows << " cars from columns" << '\n';
+
+    {
+        StringPool pool;
+        std::vector<Car> cars;
+        cars.reserve(rows);
+
+        auto begin = std::chrono::steady_clock::now();
+        for (std::size_t row = 0; row < rows; ++row) {
+            cars.push_back(CarBuilder{std::string(columns.names[row])}
+                                   .set_engine(Engine{pool.intern(columns.manufacturers[row]), columns.engine_types[row]})
+                                   .set_owner(std::string(columns.owners[row]))
+                                   .set_mileage(columns.mileages[row])
+                                   .get_car());
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+        std::cout << "CarBuilder per row  |  cars/s: " << static_cast<std::uint64_t>(rows / elapsed.count()) << '\n';
+    }
+
+    for (unsigned threads: {1u, 2u, 4u, 8u}) {
+        StringPool pool;
+
+        auto begin = std::chrono::steady_clock::now();
+        CarBlock cars = BulkCarBuilder{pool, threads}.build(columns);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+        std::cout << "BulkCarBuilder, " << threads << " threads  |  cars/s: "
+                  << static_cast<std::uint64_t>(rows / elapsed.count())
+                  << "  |  interned manufacturers: " << pool.size() << '\n';
+    }
+}
+
+
+int main() {
+    client();
+    benchmark();
+
+    return 0;
+}
@@ -0,0 +1,407 @@
+//
+// Fast serialization of cars for bulk export
+//
+// operator<< formats a car through iostreams field by field. CarSerializer writes the
+// same text with std::to_chars into a reusable buffer, or a compact binary record.
+// StreamingWriter collects records in large blocks and flushes several blocks with
+// one writev() call.
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <sys/uio.h>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+
+struct Engine {
+public:
+    enum Type { Undefined, Slow, Medium, Fast };
+
+public:
+    Engine()
+        : type(Slow) {}
+
+    explicit Engine(std::string manufacture, Type type = Undefined)
+        : manufacturer(std::move(manufacture)), type(type) {}
+
+    std::string manufacturer;
+    Type type;
+};
+
+
+class CarBuilder;
+class CarSerializer;
+
+
+class Car {
+public:
+    Car(std::string name)
+        : name(std::move(name)), mileage(0) {}
+
+public:
+    friend class CarBuilder;
+    friend class CarSerializer;
+    friend std::ostream &operator <<(std::ostream &output, const Car& car);
+
+private:
+    std::string name;
+    Engine engine;
+    std::string owner;
+    unsigned int mileage;
+};
+
+
+class CarBuilder {
+public:
+    explicit CarBuilder(const std::string& name = "undefined")
+        : car(name) {}
+
+    CarBuilder& set_name(std::string name) &        { car.name = std::move(name); return *this; }
+    CarBuilder& set_engine(Engine engine) &         { car.engine = std::move(engine); return *this; }
+    CarBuilder& set_owner(std::string owner) &      { car.owner = std::move(owner); return *this; }
+    CarBuilder& set_mileage(unsigned int mileage) & { car.mileage = mileage; return *this; }
+
+    CarBuilder&& set_name(std::string name) &&        { return std::move(set_name(std::move(name))); }
+    CarBuilder&& set_engine(Engine engine) &&         { return std::move(set_engine(std::move(engine))); }
+    CarBuilder&& set_owner(std::string owner) &&      { return std::move(set_owner(std::move(owner))); }
+    CarBuilder&& set_mileage(unsigned int mileage) && { return std::move(set_mileage(mileage)); }
+
+    Car get_car() const& { return car; }
+    Car get_car() &&     { return std::move(car); }
+
+private:
+    Car car;
+};
+
+
+std::ostream &operator<<(std::ostream &output, const Car &car) {
+    output << "Name: " << car.name << "  |  "
+           << "Engine: " << car.engine.type << "  |  "
+           << "Owner: " << car.owner << "  |  "
+           << "Mileage:" << car.mileage << '\n';
+
+    return output;
+}
+
+
+// Growing byte buffer which keeps its memory after clear()
+class ByteBuffer {
+public:
+    // Returns space for at least `count` more bytes, commit() tells how many were written
+    char* reserve(std::size_t count) {
+        if (_size + count > _capacity) {
+            std::size_t capacity = std::max(_capacity * 2, _size + count);
+            auto data = std::make_unique<char[]>(capacity);
+            if (_size != 0)
+                std::memcpy(data.get(), _data.get(), _size);
+            _data = std::move(data);
+            _capacity = capacity;
+        }
+        return _data.get() + _size;
+    }
+
+    void commit(std::size_t count) { _size += count; }
+
+    void append(std::string_view bytes) {
+        if (bytes.empty())
+            return;
+        std::memcpy(reserve(bytes.size()), bytes.data(), bytes.size());
+        commit(bytes.size());
+    }
+
+    void clear() { _size = 0; }
+
+    const char* data() const { return _data.get(); }
+    std::size_t size() const { return _size; }
+    std::size_t capacity() const { return _capacity; }
+    std::string_view view() const { return {data(), size()}; }
+
+private:
+    std::unique_ptr<char[]> _data;
+    std::size_t _size = 0;
+    std::size_t _capacity = 0;
+};
+
+
+class CarSerializer {
+public:
+    enum class Format { Text, Binary };
+
+    explicit CarSerializer(Format format = Format::Text)
+        : _format(format) {}
+
+    // Upper bound of the record size, used to reserve space once per car
+    static std::size_t max_size(const Car& car) {
+        return car.name.size() + car.owner.size() + 96;
+    }
+
+    void write(const Car& car, ByteBuffer& output) const {
+        char* begin = output.reserve(max_size(car));
+        char* end = _format == Format::Text ? write_text(car, begin) : write_binary(car, begin);
+        output.commit(end - begin);
+    }
+
+private:
+    // Same text as operator<<
+    static char* write_text(const Car& car, char* out) {
+        out = put(out, "Name: ");
+        out = put(out, car.name);
+        out = put(out, "  |  Engine: ");
+        out = std::to_chars(out, out + 16, static_cast<int>(car.engine.type)).ptr;
+        out = put(out, "  |  Owner: ");
+        out = put(out, car.owner);
+        out = put(out, "  |  Mileage:");
+        out = std::to_chars(out, out + 16, car.mileage).ptr;
+        *out++ = '\n';
+        return out;
+    }
+
+    // <varint name size><name><engine type byte><varint owner size><owner><varint mileage>
+    static char* write_binary(const Car& car, char* out) {
+        out = put_varint(out, car.name.size());
+        out = put(out, car.name);
+        *out++ = static_cast<char>(car.engine.type);
+        out = put_varint(out, car.owner.size());
+        out = put(out, car.owner);
+        out = put_varint(out, car.mileage);
+        return out;
+    }
+
+    static char* put(char* out, std::string_view text) {
+        std::memcpy(out, text.data(), text.size());
+        return out + text.size();
+    }
+
+    static char* put_varint(char* out, std::uint64_t value) {
+        while (value >= 0x80) {
+            *out++ = static_cast<char>(value | 0x80);
+            value >>= 7;
+        }
+        *out++ = static_cast<char>(value);
+        return out;
+    }
+
+    Format _format;
+};
+
+
+// Serializes cars into blocks and writes full blocks to the file descriptor with writev(),
+// `blocks_per_flush` at a time. Blocks are reused, so steady state export doesn't allocate.
+class StreamingWriter {
+public:
+    StreamingWriter(int fd, CarSerializer serializer, std::size_t block_size = 1 << 18, std::size_t blocks_per_flush = 16)
+        : _fd(fd), _serializer(serializer), _block_size(block_size), _blocks(blocks_per_flush),
+          _uncaught_exceptions(std::uncaught_exceptions()) {
+        for (auto& block: _blocks)
+            block.reserve(_block_size);
+        _vectors.reserve(_blocks.size());
+    }
+
+    ~StreamingWriter() {
+        // Export is failing if the writer is destroyed during unwinding, don't write more of it
+        if (std::uncaught_exceptions() > _uncaught_exceptions)
+            return;
+
+        try {
+            flush();
+        }
+        catch (...) {
+            // Destructor must not throw, call flush() explicitly to see errors
+        }
+    }
+
+    StreamingWriter(const StreamingWriter&) = delete;
+    StreamingWriter& operator=(const StreamingWriter&) = delete;
+
+    void write(const Car& car) {
+        if (_blocks[_current].size() + CarSerializer::max_size(car) > _block_size)
+            next_block();
+
+        _serializer.write(car, _blocks[_current]);
+    }
+
+    void flush() {
+        _vectors.clear();
+        for (std::size_t i = 0; i <= _current; ++i) {
+            if (_blocks[i].size() != 0)
+                _vectors.push_back({const_cast<char*>(_blocks[i].data()), _blocks[i].size()});
+        }
+
+        // Blocks are dropped even if writing fails, part of them may be written already
+        // and must not be sent again by the next flush()
+        try {
+            write_all(_vectors);
+        }
+        catch (...) {
+            clear();
+            throw;
+        }
+        clear();
+    }
+
+    std::uint64_t bytes_written() const { return _bytes; }
+
+private:
+    void clear() {
+        for (std::size_t i = 0; i <= _current; ++i)
+            _blocks[i].clear();
+        _current = 0;
+    }
+
+    void next_block() {
+        if (_current + 1 == _blocks.size())
+            flush();
+        else
+            ++_current;
+    }
+
+    void write_all(std::vector<iovec>& vectors) {
+        iovec* first = vectors.data();
+        std::size_t count = vectors.size();
+
+        while (count > 0) {
+            ssize_t written = ::writev(_fd, first, static_cast<int>(std::min<std::size_t>(count, IOV_MAX)));
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw std::system_error(errno, std::generic_category(), "writev");
+            }
+
+            _bytes += written;
+
+            // Skip what was written, writev may stop in the middle of a block
+            auto left = static_cast<std::size_t>(written);
+            while (count > 0 && left >= first->iov_len) {
+                left -= first->iov_len;
+                ++first;
+                --count;
+            }
+            if (count > 0) {
+                first->iov_base = static_cast<char*>(first->iov_base) + left;
+                first->iov_len -= left;
+            }
+        }
+    }
+
+    int _fd;
+    CarSerializer _serializer;
+    std::size_t _block_size;
+    std::vector<ByteBuffer> _blocks;
+    std::vector<iovec> _vectors;
+    std::size_t _current = 0;
+    std::uint64_t _bytes = 0;
+    int _uncaught_exceptions;
+};
+
+
+std::vector<Car> make_cars(std::size_t count) {
+    const Engine engines[] = {Engine("BMW", Engine::Fast), Engine("Mercedes", Engine::Medium), Engine("Kia")};
+    const char* names[] = {"BMW", "Mercedes", "Kia"};
+
+    std::vector<Car> cars;
+    cars.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        cars.push_back(CarBuilder{names[i % 3]}
+                               .set_engine(engines[i % 3])
+                               .set_owner("Owner " + std::to_string(i))
+                               .set_mileage(static_cast<unsigned int>(i * 37 % 500'000))
+                               .get_car());
+    }
+    return cars;
+}
+
+
+void client() {
+    std::vector<Car> cars = make_cars(2);
+
+    ByteBuffer buffer;
+    CarSerializer text{CarSerializer::Format::Text};
+    for (const auto& car: cars)
+        text.write(car, buffer);
+
+    std::ostringstream stream;
+    for (const auto& car: cars)
+        stream << car;
+
+    std::cout << buffer.view();
+    std::cout << "Same as operator<<: " << (buffer.view() == stream.str()) << '\n';
+
+    buffer.clear();
+    CarSerializer{CarSerializer::Format::Binary}.write(cars[0], buffer);
+    std::cout << "Binary record: " << buffer.size() << " bytes" << '\n';
+
+    // Name: BMW  |  Engine: 3  |  Owner: Owner 0  |  Mileage:0
+    // Name: Mercedes  |  Engine: 2  |  Owner: Owner 1  |  Mileage:37
+    // Same as operator<<: 1
+    // Binary record: 14 bytes
+}
+
+
+void benchmark() {
+    constexpr std::size_t cars_count = 2'000'000;
+    std::vector<Car> cars = make_cars(cars_count);
+
+    auto report = [](const char* name, std::uint64_t bytes, std::chrono::duration<double> elapsed) {
+        std::cout << name << "  |  MB/s: " << static_cast<std::uint64_t>(bytes / elapsed.count() / 1e6)
+                  << "  |  MB: " << bytes / 1e6 << '\n';
+    };
+
+    std::cout << "\nexport of " << cars_count << " cars to /dev/null" << '\n';
+
+    std::uint64_t text_bytes = 0;
+
+    for (auto format: {CarSerializer::Format::Text, CarSerializer::Format::Binary}) {
+        int fd = ::open("/dev/null", O_WRONLY);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "open");
+
+        std::uint64_t bytes;
+        auto begin = std::chrono::steady_clock::now();
+        {
+            StreamingWriter writer{fd, CarSerializer{format}};
+            for (const auto& car: cars)
+                writer.write(car);
+            writer.flush();
+            bytes = writer.bytes_written();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        ::close(fd);
+
+        if (format == CarSerializer::Format::Text)
+            text_bytes = bytes;
+        report(format == CarSerializer::Format::Text ? "writev, text         " : "writev, binary       ", bytes, elapsed);
+    }
+
+    // operator<< produces the same text, so the same number of bytes
+    std::ofstream output{"/dev/null"};
+    auto begin = std::chrono::steady_clock::now();
+    for (const auto& car: cars)
+        output << car;
+    output.flush();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    report("iostream operator<<  ", text_bytes, elapsed);
+}
+
+
+int main() {
+    client();
+    benchmark();
+
+    return 0;
+}
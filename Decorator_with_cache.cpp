@@ -0,0 +1,387 @@
+/*
+ * Decorator pattern: caching decorator
+ *
+ * Intent: same as in Decorator.cpp. Result of a component is deterministic until the
+ * component changes, so a decorator can memoize it. Components report changes through
+ * a version counter, decorators forward it, and the cache is invalidated when it moves.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+struct CacheStats {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t evictions = 0;
+
+    double hit_rate() const {
+        return hits + misses == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(hits + misses);
+    }
+
+    friend std::ostream& operator<<(std::ostream& output, const CacheStats& stats) {
+        return output << "hits: " << stats.hits << ", misses: " << stats.misses
+                      << ", evictions: " << stats.evictions << ", hit rate: " << stats.hit_rate();
+    }
+};
+
+
+// Base abstract component
+class Component {
+public:
+    virtual ~Component() = default;
+    virtual std::string operator()() const = 0;
+
+    // Changes every time the result of operator() may change
+    virtual std::uint64_t version() const { return 0; }
+};
+
+
+class ConcreteComponent : public Component {
+public:
+    std::string operator()() const override {
+        return "Concrete Component";
+    }
+};
+
+
+// Component with state, every change increases the version
+class MutableComponent : public Component {
+public:
+    explicit MutableComponent(std::string text) : _text(std::move(text)) {}
+
+    std::string operator()() const override { return _text; }
+    std::uint64_t version() const override { return _version; }
+
+    void set_text(std::string text) {
+        _text = std::move(text);
+        ++_version;
+    }
+
+private:
+    std::string _text;
+    std::uint64_t _version = 0;
+};
+
+
+class Decorator : public Component {
+public:
+    explicit Decorator(Component* component)
+        : _component(component) {}
+
+    std::string operator()() const override {
+        return (*_component)();
+    }
+
+    // Decorator changes when anything inside it changes
+    std::uint64_t version() const override {
+        return _component->version();
+    }
+
+protected:
+    std::unique_ptr<Component> _component;
+};
+
+
+class DecoratorA : public Decorator {
+public:
+    explicit DecoratorA(Component* component)
+        : Decorator(component) {}
+
+    std::string operator()() const override {
+        return "Decorator A(" + Decorator::operator()() + ")";
+    }
+};
+
+
+class DecoratorB : public Decorator {
+public:
+    explicit DecoratorB(Component* component)
+        : Decorator(component) {}
+
+    std::string operator()() const override {
+        return "Decorator B(" + Decorator::operator()() + ")";
+    }
+};
+
+
+// Memoizes the result of the wrapped component until its version changes.
+// Not thread safe, one decorator is meant to be used by one thread.
+class CachingDecorator : public Decorator {
+public:
+    explicit CachingDecorator(Component* component)
+        : Decorator(component) {}
+
+    std::string operator()() const override {
+        return cached();
+    }
+
+    const std::string& cached() const {
+        std::uint64_t version = _component->version();
+
+        if (_valid && version == _cached_version) {
+            ++_stats.hits;
+        }
+        else {
+            ++_stats.misses;
+            _cached = (*_component)();
+            _cached_version = version;
+            _valid = true;
+        }
+
+        return _cached;
+    }
+
+    const CacheStats& stats() const { return _stats; }
+
+private:
+    mutable std::string _cached;
+    mutable std::uint64_t _cached_version = 0;
+    mutable bool _valid = false;
+    mutable CacheStats _stats;
+};
+
+
+// Component whose result depends on a parameter, e.g. user id
+class ParameterizedComponent {
+public:
+    virtual ~ParameterizedComponent() = default;
+    virtual std::string operator()(std::uint64_t parameter) const = 0;
+    virtual std::uint64_t version() const { return 0; }
+};
+
+
+class ReportComponent : public ParameterizedComponent {
+public:
+    std::string operator()(std::uint64_t parameter) const override {
+        std::string report = "Report #" + std::to_string(parameter) + ":";
+        for (int i = 0; i < 16; ++i)
+            report += ' ' + std::to_string(parameter * 31 + i);
+        return report;
+    }
+
+    std::uint64_t version() const override { return _version.load(std::memory_order_acquire); }
+
+    void invalidate() { _version.fetch_add(1, std::memory_order_release); }
+
+private:
+    std::atomic<std::uint64_t> _version{0};
+};
+
+
+// Thread safe LRU cache. Keys are spread over shards, each shard has its own lock,
+// list in recency order and index, so threads rarely wait for each other.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class ShardedLruCache {
+public:
+    explicit ShardedLruCache(std::size_t capacity, std::size_t shards = 16) {
+        shards = std::max<std::size_t>(shards, 1);
+        for (std::size_t i = 0; i < shards; ++i)
+            _shards.push_back(std::make_unique<Shard>(std::max<std::size_t>(capacity / shards, 1)));
+    }
+
+    // Returns cached value if it was computed for the same version, otherwise computes it.
+    // Compute runs without lock, so a slow component doesn't block the whole shard.
+    template <typename Compute>
+    Value get_or_compute(const Key& key, std::uint64_t version, Compute compute) {
+        Shard& shard = *_shards[_hash(key) % _shards.size()];
+
+        {
+            std::lock_guard lock(shard.mutex);
+            auto found = shard.index.find(key);
+            if (found != shard.index.end() && found->second->version == version) {
+                ++shard.stats.hits;
+                shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+                return found->second->value;
+            }
+            ++shard.stats.misses;
+        }
+
+        Value value = compute(key);
+
+        std::lock_guard lock(shard.mutex);
+        auto found = shard.index.find(key);
+        if (found != shard.index.end()) {
+            found->second->value = value;
+            found->second->version = version;
+            shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+            return value;
+        }
+
+        if (shard.entries.size() == shard.capacity) {
+            shard.index.erase(shard.entries.back().key);
+            shard.entries.pop_back();
+            ++shard.stats.evictions;
+        }
+
+        shard.entries.push_front({key, value, version});
+        shard.index.emplace(key, shard.entries.begin());
+        return value;
+    }
+
+    CacheStats stats() const {
+        CacheStats total;
+        for (const auto& shard: _shards) {
+            std::lock_guard lock(shard->mutex);
+            total.hits += shard->stats.hits;
+            total.misses += shard->stats.misses;
+            total.evictions += shard->stats.evictions;
+        }
+        return total;
+    }
+
+private:
+    struct Entry {
+        Key key;
+        Value value;
+        std::uint64_t version;
+    };
+
+    struct Shard {
+        explicit Shard(std::size_t capacity) : capacity(capacity) {}
+
+        mutable std::mutex mutex;
+        std::list<Entry> entries;
+        std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> index;
+        std::size_t capacity;
+        CacheStats stats;
+    };
+
+    std::vector<std::unique_ptr<Shard>> _shards;
+    Hash _hash;
+};
+
+
+// Caching decorator for parameterized components, safe to share between threads
+class CachingParameterizedDecorator : public ParameterizedComponent {
+public:
+    CachingParameterizedDecorator(const ParameterizedComponent& component, std::size_t capacity, std::size_t shards = 16)
+        : _component(component), _cache(capacity, shards) {}
+
+    std::string operator()(std::uint64_t parameter) const override {
+        return _cache.get_or_compute(parameter, _component.version(),
+                                     [this](std::uint64_t key) { return _component(key); });
+    }
+
+    std::uint64_t version() const override { return _component.version(); }
+
+    CacheStats stats() const { return _cache.stats(); }
+
+private:
+    const ParameterizedComponent& _component;
+    mutable ShardedLruCache<std::uint64_t, std::string> _cache;
+};
+
+
+void client() {
+    auto* text = new MutableComponent("Mutable Component");
+    CachingDecorator cached{new DecoratorA(new DecoratorB(text))};
+
+    std::cout << cached() << '\n';  // Decorator A(Decorator B(Mutable Component))
+    std::cout << cached() << '\n';  // Decorator A(Decorator B(Mutable Component))
+
+    // Inner component changes, version goes up and cache is recomputed
+    text->set_text("Changed Component");
+    std::cout << cached() << '\n';  // Decorator A(Decorator B(Changed Component))
+
+    std::cout << cached.stats() << '\n';    // hits: 1, misses: 2, evictions: 0, hit rate: 0.333333
+
+    ReportComponent reports;
+    CachingParameterizedDecorator cached_reports{reports, 2, 1};
+    cached_reports(1);
+    cached_reports(2);
+    cached_reports(1);
+    cached_reports(3);  // evicts 2
+    cached_reports(2);
+
+    // Cached 2 belongs to the old version
+    reports.invalidate();
+    cached_reports(2);
+
+    std::cout << cached_reports.stats() << '\n';    // hits: 1, misses: 5, evictions: 2, hit rate: 0.166667
+}
+
+
+void benchmark() {
+    constexpr int depth = 16;
+    constexpr int calls = 1'000'000;
+
+    Component* chain = new ConcreteComponent();
+    for (int i = 0; i < depth; ++i)
+        chain = i % 2 ? static_cast<Component*>(new DecoratorA(chain)) : new DecoratorB(chain);
+
+    std::unique_ptr<Component> plain{chain};
+    std::size_t checksum = 0;
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i)
+        checksum += (*plain)().size();
+    std::chrono::duration<double, std::nano> plain_time = std::chrono::steady_clock::now() - begin;
+
+    // Same chain, but wrapped into the cache
+    CachingDecorator cached{plain.release()};
+
+    begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i)
+        checksum += cached.cached().size();
+    std::chrono::duration<double, std::nano> cached_time = std::chrono::steady_clock::now() - begin;
+
+    std::cout << "\nrepeated calls, depth " << depth << '\n';
+    std::cout << "plain   |  ns/call: " << plain_time.count() / calls << '\n';
+    std::cout << "cached  |  ns/call: " << cached_time.count() / calls << "  |  " << cached.stats() << '\n';
+
+    // Parameterized component shared between threads. 90% of calls go to 10% of keys
+    constexpr std::uint64_t keys = 20'000;
+    constexpr int calls_total = 500'000;
+
+    ReportComponent reports;
+    std::cout << "\nsharded LRU, " << keys << " keys, capacity " << keys / 5 << " (checksum " << checksum << ")" << '\n';
+
+    for (int threads_count: {1, 2, 4, 8}) {
+        CachingParameterizedDecorator cached_reports{reports, keys / 5};
+
+        begin = std::chrono::steady_clock::now();
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threads_count; ++t) {
+            threads.emplace_back([&, t] {
+                std::uint64_t state = 88172645463325252ull + t;
+                std::size_t local = 0;
+                for (int i = 0; i < calls_total / threads_count; ++i) {
+                    state ^= state << 13, state ^= state >> 7, state ^= state << 17;
+                    std::uint64_t key = state % 10 ? state % (keys / 10) : state % keys;
+                    local += cached_reports(key).size();
+                }
+                std::atomic_ref<std::size_t>(checksum).fetch_add(local);
+            });
+        }
+        for (auto& thread: threads)
+            thread.join();
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+        std::cout << "threads: " << threads_count
+                  << "  |  calls/s: " << static_cast<std::uint64_t>(calls_total / elapsed.count())
+                  << "  |  " << cached_reports.stats() << '\n';
+    }
+}
+
+
+int main() {
+    client();
+    benchmark();
+
+    return 0;
+}
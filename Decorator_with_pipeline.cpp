@@ -0,0 +1,249 @@
+/*
+ * Decorator pattern: flattened pipeline
+ *
+ * Intent: same as in Decorator.cpp. Nested decorators recurse through virtual calls and
+ * every layer builds a new string, so a chain of depth N copies O(N^2) characters.
+ * The pipeline keeps the chain as a flat list of stages and writes the whole result
+ * into one preallocated buffer.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+// Base abstract component
+class Component {
+public:
+    virtual ~Component() = default;
+    virtual std::string operator()() const = 0;
+
+    // Appends result to the buffer. Components can override it to avoid temporary strings
+    virtual void write(std::string& output) const { output += (*this)(); }
+};
+
+
+class ConcreteComponent : public Component {
+public:
+    std::string operator()() const override {
+        return "Concrete Component";
+    }
+
+    void write(std::string& output) const override {
+        output += "Concrete Component";
+    }
+};
+
+
+class NewCoolConcreteComponent : public Component {
+public:
+    std::string operator()() const override {
+        return "New Cool Concrete Component!";
+    }
+
+    void write(std::string& output) const override {
+        output += "New Cool Concrete Component!";
+    }
+};
+
+
+// Classic nested decorators from Decorator.cpp, used as baseline
+class Decorator : public Component {
+public:
+    explicit Decorator(Component* component)
+        : _component(component) {}
+
+    std::string operator()() const override {
+        return (*_component)();
+    }
+
+protected:
+    std::unique_ptr<Component> _component;
+};
+
+
+class DecoratorA : public Decorator {
+public:
+    explicit DecoratorA(Component* component)
+        : Decorator(component) {}
+
+    std::string operator()() const override {
+        return "Decorator A(" + Decorator::operator()() + ")";
+    }
+};
+
+
+class DecoratorB : public Decorator {
+public:
+    explicit DecoratorB(Component* component)
+        : Decorator(component) {}
+
+    std::string operator()() const override {
+        return "Decorator B(" + Decorator::operator()() + ")";
+    }
+};
+
+
+// Every decorator of this kind only adds text before and after the wrapped result,
+// so it can be described by data instead of a virtual call
+struct Stage {
+    std::string prefix;
+    std::string suffix;
+};
+
+inline Stage decorator_a() { return {"Decorator A(", ")"}; }
+inline Stage decorator_b() { return {"Decorator B(", ")"}; }
+
+
+// Pipeline stores stages from inner to outer:
+// DecoratorA(DecoratorB(component)) == DecoratorPipeline(component).wrap(decorator_b()).wrap(decorator_a())
+class DecoratorPipeline {
+public:
+    explicit DecoratorPipeline(const Component& component)
+        : _component(component) {}
+
+    DecoratorPipeline& wrap(Stage stage) {
+        _stages.push_back(std::move(stage));
+        _decorations_size += _stages.back().prefix.size() + _stages.back().suffix.size();
+        return *this;
+    }
+
+    // Merges all stages into one, so render() does only three appends regardless of depth.
+    // Call it when the chain is built and won't change anymore.
+    DecoratorPipeline& fuse() {
+        if (_stages.size() < 2)
+            return *this;
+
+        Stage fused;
+        fused.prefix.reserve(_decorations_size);
+        fused.suffix.reserve(_decorations_size);
+
+        for (auto stage = _stages.rbegin(); stage != _stages.rend(); ++stage)
+            fused.prefix += stage->prefix;
+        for (const auto& stage: _stages)
+            fused.suffix += stage.suffix;
+
+        _stages.clear();
+        _stages.push_back(std::move(fused));
+        return *this;
+    }
+
+    // Appends result to the output. When the same buffer is reused, nothing is allocated
+    void render(std::string& output) const {
+        output.reserve(output.size() + _decorations_size);
+
+        for (auto stage = _stages.rbegin(); stage != _stages.rend(); ++stage)
+            output += stage->prefix;
+
+        _component.write(output);
+
+        for (const auto& stage: _stages)
+            output += stage.suffix;
+    }
+
+    std::string operator()() const {
+        std::string output;
+        render(output);
+        return output;
+    }
+
+    std::size_t depth() const { return _stages.size(); }
+
+private:
+    const Component& _component;
+    std::vector<Stage> _stages;
+    std::size_t _decorations_size = 0;
+};
+
+
+void client() {
+    ConcreteComponent component{};
+    NewCoolConcreteComponent new_cool_concrete_component{};
+
+    DecoratorPipeline pipeline1{component};
+    pipeline1.wrap(decorator_a());
+
+    DecoratorPipeline pipeline2{new_cool_concrete_component};
+    pipeline2.wrap(decorator_b()).wrap(decorator_a());
+
+    DecoratorPipeline pipeline3{new_cool_concrete_component};
+    pipeline3.wrap(decorator_b()).wrap(decorator_a()).wrap(decorator_b()).fuse();
+
+    std::cout << pipeline1() << '\n';   // Decorator A(Concrete Component)
+    std::cout << pipeline2() << '\n';   // Decorator A(Decorator B(New Cool Concrete Component!))
+    std::cout << pipeline3() << '\n';   // Decorator B(Decorator A(Decorator B(New Cool Concrete Component!)))
+
+    // Render several pipelines into one buffer
+    std::string buffer;
+    pipeline1.render(buffer);
+    buffer += "; ";
+    pipeline2.render(buffer);
+    std::cout << buffer << '\n';        // Decorator A(Concrete Component); Decorator A(Decorator B(New Cool Concrete Component!))
+}
+
+
+template <typename Call>
+double measure(int calls, Call call) {
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i)
+        call();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - begin;
+
+    return elapsed.count() / calls;
+}
+
+
+void benchmark() {
+    constexpr int calls = 200'000;
+
+    ConcreteComponent component{};
+
+    std::cout << "\nns per call" << '\n';
+    for (int depth: {1, 2, 4, 8, 16, 32, 64}) {
+        std::unique_ptr<Component> nested = std::make_unique<ConcreteComponent>();
+        DecoratorPipeline pipeline{component};
+        DecoratorPipeline fused{component};
+
+        for (int i = 0; i < depth; ++i) {
+            if (i % 2) {
+                nested = std::make_unique<DecoratorA>(nested.release());
+                pipeline.wrap(decorator_a());
+                fused.wrap(decorator_a());
+            }
+            else {
+                nested = std::make_unique<DecoratorB>(nested.release());
+                pipeline.wrap(decorator_b());
+                fused.wrap(decorator_b());
+            }
+        }
+        fused.fuse();
+
+        std::size_t checksum = 0;
+        std::string buffer;
+
+        double nested_cost = measure(calls, [&] { checksum += (*nested)().size(); });
+        double pipeline_cost = measure(calls, [&] { buffer.clear(); pipeline.render(buffer); checksum += buffer.size(); });
+        double fused_cost = measure(calls, [&] { buffer.clear(); fused.render(buffer); checksum += buffer.size(); });
+
+        if ((*nested)() != pipeline() || pipeline() != fused())
+            std::cout << "Results differ!" << '\n';
+
+        std::cout << "depth: " << depth
+                  << "  |  nested: " << nested_cost
+                  << "  |  pipeline: " << pipeline_cost
+                  << "  |  fused: " << fused_cost
+                  << "  |  (checksum " << checksum << ")" << '\n';
+    }
+}
+
+
+int main() {
+    client();
+    benchmark();
+
+    return 0;
+}
@@ -33,7 +33,7 @@ public:
 
 class Facade {
 public:
-    Facade() : _subsystem_1(), _subsystem_2() {}
+    Facade() : _subsystem_1(std::make_unique<Subsystem1>()), _subsystem_2(std::make_unique<Subsystem2>()) {}
 
     // Facade does all setup of the system. Client only needs to call one method of facade to setup system.
     void setup_system() {
@@ -0,0 +1,293 @@
+/*
+ * Facade pattern: lazy subsystems
+ *
+ * Intent: same as in Facade.cpp, one simple interface to a complex system. Facade there gets
+ * every subsystem ready up front, even when a client uses only one of them. LazyFacade
+ * creates and readies a subsystem on its first use, exactly once even when many threads ask
+ * for it at the same time. Subsystems which are likely to be needed soon can be prewarmed
+ * in background.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "HeapUsage.h"
+
+using Clock = std::chrono::steady_clock;
+using Milliseconds = std::chrono::duration<double, std::milli>;
+
+
+class Subsystem {
+public:
+    virtual ~Subsystem() = default;
+
+    virtual void get_ready() = 0;
+    virtual std::size_t handle(std::size_t request) = 0;
+};
+
+
+// Subsystem which keeps `memory` bytes of state and whose get_ready() takes `delay`
+class SyntheticSubsystem : public Subsystem {
+public:
+    SyntheticSubsystem(std::size_t memory, Milliseconds delay)
+        : _state(memory), _delay(delay) {}
+
+    void get_ready() override {
+        std::this_thread::sleep_for(_delay);
+        for (std::size_t i = 0; i < _state.size(); i += 4096)
+            _state[i] = static_cast<char>(i);
+        ++readies;
+    }
+
+    std::size_t handle(std::size_t request) override { return request + _state.size(); }
+
+    static inline std::atomic<int> readies{0};
+
+private:
+    std::vector<char> _state;
+    Milliseconds _delay;
+};
+
+
+using SubsystemFactory = std::function<std::unique_ptr<Subsystem>()>;
+
+
+// Creates and readies its subsystem once, on the first get()
+class LazySubsystem {
+public:
+    explicit LazySubsystem(SubsystemFactory factory)
+        : _factory(std::move(factory)) {}
+
+    Subsystem& get() {
+        // Ready subsystem is found without taking the mutex
+        if (Subsystem* subsystem = _ready.load(std::memory_order_acquire))
+            return *subsystem;
+
+        // Not std::call_once: on libstdc++ an exception thrown from it can leave later calls
+        // hanging (GCC PR 66146). With a mutex, if the factory or get_ready() throws,
+        // the next get() tries again.
+        std::lock_guard lock(_mutex);
+        if (!_subsystem) {
+            auto subsystem = _factory();
+            subsystem->get_ready();
+            _subsystem = std::move(subsystem);
+            _ready.store(_subsystem.get(), std::memory_order_release);
+        }
+        return *_subsystem;
+    }
+
+    bool is_ready() const { return _ready.load(std::memory_order_acquire) != nullptr; }
+
+private:
+    SubsystemFactory _factory;
+    std::mutex _mutex;
+    std::unique_ptr<Subsystem> _subsystem;
+    std::atomic<Subsystem*> _ready{nullptr};
+};
+
+
+class LazyFacade {
+public:
+    LazyFacade() = default;
+    LazyFacade(const LazyFacade&) = delete;
+    LazyFacade& operator=(const LazyFacade&) = delete;
+
+    // Stops prewarming before subsystems are destroyed
+    ~LazyFacade() { _prewarmers.clear(); }
+
+    void add(const std::string& name, SubsystemFactory factory) {
+        _index.emplace(name, _subsystems.size());
+        _subsystems.push_back(std::make_unique<LazySubsystem>(std::move(factory)));
+    }
+
+    // Client works with subsystems by name, the subsystem is readied if it is used first time.
+    // Subsystems must not be added after the first request.
+    std::size_t request(const std::string& name, std::size_t request) {
+        return subsystem(name).get().handle(request);
+    }
+
+    // Readies predicted subsystems in a background thread, in the given order. A subsystem
+    // which fails to get ready is skipped and left for request() to try again.
+    void prewarm(std::vector<std::string> predicted) {
+        std::vector<LazySubsystem*> subsystems;
+        for (const auto& name: predicted)
+            subsystems.push_back(&subsystem(name));
+
+        _prewarmers.emplace_back([subsystems = std::move(subsystems)](std::stop_token stop) {
+            for (LazySubsystem* lazy: subsystems) {
+                if (stop.stop_requested())
+                    return;
+                try {
+                    lazy->get();
+                }
+                catch (...) {
+                }
+            }
+        });
+    }
+
+    std::size_t ready_count() const {
+        return std::count_if(_subsystems.begin(), _subsystems.end(), [](const auto& lazy) { return lazy->is_ready(); });
+    }
+
+private:
+    LazySubsystem& subsystem(const std::string& name) {
+        auto found = _index.find(name);
+        if (found == _index.end())
+            throw std::out_of_range("Unknown subsystem: " + name);
+        return *_subsystems[found->second];
+    }
+
+    std::vector<std::unique_ptr<LazySubsystem>> _subsystems;
+    std::unordered_map<std::string, std::size_t> _index;
+    std::vector<std::jthread> _prewarmers;   // last member, so threads stop before the rest is destroyed
+};
+
+
+// Facade from Facade.cpp: every subsystem is readied as soon as it is added
+class EagerFacade {
+public:
+    void add(const std::string& name, const SubsystemFactory& factory) {
+        _index.emplace(name, _subsystems.size());
+        _subsystems.push_back(factory());
+        _subsystems.back()->get_ready();
+    }
+
+    std::size_t request(const std::string& name, std::size_t request) {
+        return _subsystems.at(_index.at(name))->handle(request);
+    }
+
+private:
+    std::vector<std::unique_ptr<Subsystem>> _subsystems;
+    std::unordered_map<std::string, std::size_t> _index;
+};
+
+
+constexpr std::size_t subsystems_count = 50;
+
+std::string name_of(std::size_t i) { return "subsystem" + std::to_string(i); }
+
+// 1-2 MB of state, 2-6 ms to get ready
+SubsystemFactory factory_of(std::size_t i) {
+    return [i] {
+        return std::make_unique<SyntheticSubsystem>((1 + i % 2) << 20, Milliseconds(2 + static_cast<double>(i % 5)));
+    };
+}
+
+
+void client() {
+    LazyFacade facade;
+    for (std::size_t i = 0; i < subsystems_count; ++i)
+        facade.add(name_of(i), factory_of(i));
+
+    // Factory fails on the first try
+    int attempts = 0;
+    facade.add("flaky", [&]() -> std::unique_ptr<Subsystem> {
+        if (++attempts == 1)
+            throw std::runtime_error("Not available yet");
+        return factory_of(0)();
+    });
+
+    std::cout << "Ready after construction: " << facade.ready_count() << '\n';
+
+    // Eight threads use the same subsystem at once, it is readied only once
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i)
+        threads.emplace_back([&] { facade.request("subsystem7", 1); });
+    for (auto& thread: threads)
+        thread.join();
+
+    std::cout << "Ready after requests to subsystem7: " << facade.ready_count()
+              << ", get_ready() calls: " << SyntheticSubsystem::readies << '\n';
+
+    // Prewarm skips flaky, the request creates it again
+    facade.prewarm({"flaky", "subsystem8"});
+    while (facade.ready_count() < 2)
+        std::this_thread::sleep_for(Milliseconds(1));
+    facade.request("flaky", 1);
+    std::cout << "Ready after prewarm and request to flaky: " << facade.ready_count()
+              << ", factory calls: " << attempts << '\n';
+
+    // Ready after construction: 0
+    // Ready after requests to subsystem7: 1, get_ready() calls: 1
+    // Ready after prewarm and request to flaky: 3, factory calls: 2
+}
+
+
+void benchmark() {
+    std::cout << "\n" << subsystems_count << " subsystems, 1-2 MB of state and 2-6 ms to get ready each" << '\n';
+
+    // Time to first request of the prewarmed case is set by the client delay, so it is not reported
+    auto report = [](const char* name, std::optional<Milliseconds> to_first, Milliseconds latency, std::size_t bytes) {
+        std::cout << name << "  |  time to first request ms: ";
+        if (to_first)
+            std::cout << to_first->count();
+        else
+            std::cout << "-";
+        std::cout << "  |  request latency ms: " << latency.count()
+                  << "  |  MB: " << bytes / 1e6 << '\n';
+    };
+
+    {
+        std::size_t before = heap_usage::live_bytes();
+        auto begin = Clock::now();
+        EagerFacade facade;
+        for (std::size_t i = 0; i < subsystems_count; ++i)
+            facade.add(name_of(i), factory_of(i));
+
+        auto request = Clock::now();
+        facade.request("subsystem7", 1);
+        auto end = Clock::now();
+        report("eager               ", end - begin, end - request, heap_usage::live_bytes() - before);
+    }
+
+    {
+        std::size_t before = heap_usage::live_bytes();
+        auto begin = Clock::now();
+        LazyFacade facade;
+        for (std::size_t i = 0; i < subsystems_count; ++i)
+            facade.add(name_of(i), factory_of(i));
+
+        auto request = Clock::now();
+        facade.request("subsystem7", 1);
+        auto end = Clock::now();
+        report("lazy                ", end - begin, end - request, heap_usage::live_bytes() - before);
+    }
+
+    {
+        std::size_t before = heap_usage::live_bytes();
+        LazyFacade facade;
+        for (std::size_t i = 0; i < subsystems_count; ++i)
+            facade.add(name_of(i), factory_of(i));
+
+        // Client usually needs these, and connects 30 ms after start
+        facade.prewarm({"subsystem7", "subsystem8", "subsystem9", "subsystem10", "subsystem11"});
+        std::this_thread::sleep_for(Milliseconds(30));
+
+        auto request = Clock::now();
+        facade.request("subsystem7", 1);
+        auto end = Clock::now();
+        report("lazy, 5 prewarmed   ", std::nullopt, end - request, heap_usage::live_bytes() - before);
+    }
+}
+
+
+int main() {
+    client();
+    benchmark();
+
+    return 0;
+}
@@ -0,0 +1,326 @@
+/*
+ * Facade pattern: parallel startup of subsystems
+ *
+ * Intent: same as in Facade.cpp, one simple call sets up a complex system. setup_system() there
+ * readies subsystems one after another. Here subsystems form a dependency graph, and
+ * StartupEngine readies every subsystem as soon as all its dependencies are ready, independent
+ * ones at the same time. With enough threads for the widest layer, startup takes as long as
+ * the longest chain of dependencies (critical path), not the sum of all steps. Every setup
+ * reports when each subsystem started and became ready.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+using Milliseconds = std::chrono::duration<double, std::milli>;
+
+
+class Subsystem {
+public:
+    explicit Subsystem(std::string name)
+        : _name(std::move(name)) {}
+
+    virtual ~Subsystem() = default;
+
+    virtual void get_ready() = 0;
+    virtual void run() = 0;
+
+    const std::string& get_name() const { return _name; }
+
+private:
+    std::string _name;
+};
+
+
+// Subsystem whose get_ready() takes given time, like opening connections or loading files
+class SyntheticSubsystem : public Subsystem {
+public:
+    SyntheticSubsystem(std::string name, Milliseconds delay, bool verbose = false)
+        : Subsystem(std::move(name)), _delay(delay), _verbose(verbose) {}
+
+    void get_ready() override { std::this_thread::sleep_for(_delay); }
+
+    void run() override {
+        if (_verbose)
+            std::cout << get_name() << " is currently running..." << '\n';
+    }
+
+private:
+    Milliseconds _delay;
+    bool _verbose;
+};
+
+
+// Subsystems in order of adding. A subsystem may depend only on subsystems added before it,
+// so the graph can't have cycles and the order of adding is a valid startup order.
+class SubsystemGraph {
+public:
+    std::size_t add(std::unique_ptr<Subsystem> subsystem, std::vector<std::size_t> dependencies = {}) {
+        std::size_t id = _subsystems.size();
+        for (std::size_t dependency: dependencies) {
+            if (dependency >= id)
+                throw std::invalid_argument(subsystem->get_name() + " depends on unknown subsystem");
+        }
+        for (std::size_t dependency: dependencies)
+            _dependents[dependency].push_back(id);
+
+        _subsystems.push_back(std::move(subsystem));
+        _dependencies.push_back(std::move(dependencies));
+        _dependents.emplace_back();
+        return id;
+    }
+
+    std::size_t size() const { return _subsystems.size(); }
+    Subsystem& operator[](std::size_t id) const { return *_subsystems[id]; }
+    const std::vector<std::size_t>& dependencies(std::size_t id) const { return _dependencies[id]; }
+    const std::vector<std::size_t>& dependents(std::size_t id) const { return _dependents[id]; }
+
+private:
+    std::vector<std::unique_ptr<Subsystem>> _subsystems;
+    std::vector<std::vector<std::size_t>> _dependencies;
+    std::vector<std::vector<std::size_t>> _dependents;
+};
+
+
+struct StartupTiming {
+    std::string name;
+    Milliseconds start{};   // since the beginning of the startup
+    Milliseconds ready{};
+};
+
+
+struct StartupReport {
+    std::vector<StartupTiming> subsystems;
+    Milliseconds total{};
+    Milliseconds critical_path{};   // longest chain of dependent get_ready() calls
+    Milliseconds sequential{};      // sum of all get_ready() calls
+
+    friend std::ostream& operator<<(std::ostream& output, const StartupReport& report) {
+        output << std::fixed << std::setprecision(1);
+        for (const auto& timing: report.subsystems)
+            output << std::setw(12) << std::left << timing.name << std::right
+                   << "  |  start ms: " << std::setw(6) << timing.start.count()
+                   << "  |  ready ms: " << std::setw(6) << timing.ready.count()
+                   << "  |  took ms: " << std::setw(6) << (timing.ready - timing.start).count() << '\n';
+
+        output << "total ms: " << report.total.count()
+               << "  |  critical path ms: " << report.critical_path.count()
+               << "  |  sequential ms: " << report.sequential.count() << '\n';
+        output << std::defaultfloat;
+        return output;
+    }
+};
+
+
+class StartupEngine {
+public:
+    explicit StartupEngine(unsigned threads = 16)
+        : _threads(std::max(threads, 1u)) {}
+
+    // Calls get_ready() of every subsystem after get_ready() of all its dependencies.
+    // If one of them throws, subsystems which are not started yet are skipped and
+    // the exception is rethrown when running ones finish.
+    StartupReport get_ready(const SubsystemGraph& graph) const {
+        std::size_t count = graph.size();
+        StartupReport report;
+        report.subsystems.resize(count);
+
+        std::vector<std::size_t> waiting(count);
+        std::deque<std::size_t> ready;
+        for (std::size_t id = 0; id < count; ++id) {
+            waiting[id] = graph.dependencies(id).size();
+            if (waiting[id] == 0)
+                ready.push_back(id);
+        }
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::size_t remaining = count;
+        std::exception_ptr error;
+
+        Clock::time_point begin = Clock::now();
+
+        auto work = [&] {
+            std::unique_lock lock(mutex);
+            for (;;) {
+                wake.wait(lock, [&] { return !ready.empty() || remaining == 0 || error; });
+                if (remaining == 0 || error)
+                    return;
+
+                std::size_t id = ready.front();
+                ready.pop_front();
+                lock.unlock();
+
+                StartupTiming timing{graph[id].get_name(), Clock::now() - begin};
+                std::exception_ptr failure;
+                try {
+                    graph[id].get_ready();
+                }
+                catch (...) {
+                    failure = std::current_exception();
+                }
+                timing.ready = Clock::now() - begin;
+
+                lock.lock();
+                report.subsystems[id] = std::move(timing);
+                --remaining;
+                if (failure && !error)
+                    error = failure;
+
+                for (std::size_t dependent: graph.dependents(id)) {
+                    if (--waiting[dependent] == 0)
+                        ready.push_back(dependent);
+                }
+                wake.notify_all();
+            }
+        };
+
+        std::vector<std::thread> workers;
+        unsigned threads = static_cast<unsigned>(std::min<std::size_t>(_threads, count));
+        for (unsigned i = 1; i < threads; ++i)
+            workers.emplace_back(work);
+        if (count != 0)
+            work();
+        for (auto& worker: workers)
+            worker.join();
+
+        if (error)
+            std::rethrow_exception(error);
+
+        report.total = Clock::now() - begin;
+
+        // Subsystems are in startup order, so dependencies are counted before their dependents
+        std::vector<Milliseconds> chain(count);
+        for (std::size_t id = 0; id < count; ++id) {
+            Milliseconds longest{};
+            for (std::size_t dependency: graph.dependencies(id))
+                longest = std::max(longest, chain[dependency]);
+
+            Milliseconds took = report.subsystems[id].ready - report.subsystems[id].start;
+            chain[id] = longest + took;
+            report.critical_path = std::max(report.critical_path, chain[id]);
+            report.sequential += took;
+        }
+
+        return report;
+    }
+
+private:
+    unsigned _threads;
+};
+
+
+class Facade {
+public:
+    explicit Facade(SubsystemGraph graph, unsigned threads = 16)
+        : _graph(std::move(graph)), _engine(threads) {}
+
+    // Client still calls one method to set up the whole system
+    StartupReport setup_system() {
+        StartupReport report = _engine.get_ready(_graph);
+
+        for (std::size_t id = 0; id < _graph.size(); ++id)
+            _graph[id].run();
+
+        return report;
+    }
+
+private:
+    SubsystemGraph _graph;
+    StartupEngine _engine;
+};
+
+
+void client() {
+    SubsystemGraph graph;
+    std::size_t database = graph.add(std::make_unique<SyntheticSubsystem>("Database", Milliseconds(30), true));
+    std::size_t cache = graph.add(std::make_unique<SyntheticSubsystem>("Cache", Milliseconds(20), true));
+    std::size_t api = graph.add(std::make_unique<SyntheticSubsystem>("Api", Milliseconds(10), true), {database, cache});
+    graph.add(std::make_unique<SyntheticSubsystem>("Metrics", Milliseconds(10), true), {api});
+
+    Facade facade{std::move(graph)};
+    std::cout << facade.setup_system();
+
+    // Database is currently running...
+    // Cache is currently running...
+    // Api is currently running...
+    // Metrics is currently running...
+    // Database      |  start ms:    0.1  |  ready ms:   30.3  |  took ms:   30.1
+    // Cache         |  start ms:    0.1  |  ready ms:   20.2  |  took ms:   20.1
+    // Api           |  start ms:   30.3  |  ready ms:   40.4  |  took ms:   10.1
+    // Metrics       |  start ms:   40.4  |  ready ms:   50.5  |  took ms:   10.1
+    // total ms: 50.8  |  critical path ms: 50.3  |  sequential ms: 70.4
+}
+
+
+// Layers of subsystems, every subsystem depends on up to three subsystems of the layer before
+SubsystemGraph make_deployment(std::size_t subsystems, std::uint64_t seed) {
+    std::mt19937_64 random{seed};
+    SubsystemGraph graph;
+
+    constexpr std::size_t layer_size = 8;
+    for (std::size_t id = 0; id < subsystems; ++id) {
+        std::vector<std::size_t> dependencies;
+        std::size_t layer_begin = id / layer_size * layer_size;
+        if (layer_begin >= layer_size) {
+            std::size_t previous = layer_begin - layer_size;
+            for (std::size_t i = 0, count = random() % 3 + 1; i < count; ++i) {
+                std::size_t dependency = previous + random() % layer_size;
+                if (std::find(dependencies.begin(), dependencies.end(), dependency) == dependencies.end())
+                    dependencies.push_back(dependency);
+            }
+        }
+
+        Milliseconds delay(2 + static_cast<double>(random() % 19));
+        graph.add(std::make_unique<SyntheticSubsystem>("Subsystem" + std::to_string(id), delay), std::move(dependencies));
+    }
+    return graph;
+}
+
+
+void benchmark() {
+    constexpr std::size_t subsystems = 48;
+
+    std::cout << "\nstartup of " << subsystems << " subsystems in layers of 8, get_ready() takes 2-20 ms" << '\n';
+
+    for (unsigned threads: {1u, 4u, 16u}) {
+        Facade facade{make_deployment(subsystems, 42), threads};
+        StartupReport report = facade.setup_system();
+
+        std::cout << std::fixed << std::setprecision(1)
+                  << "threads: " << std::setw(2) << threads
+                  << "  |  total ms: " << report.total.count()
+                  << "  |  critical path ms: " << report.critical_path.count()
+                  << "  |  sequential ms: " << report.sequential.count() << '\n'
+                  << std::defaultfloat;
+    }
+
+    // One thread runs the steps one by one, so it takes the sequential sum. Four threads
+    // wait for each other within a layer of 8, and only 16 get close to the critical path.
+    //
+    // threads:  1  |  total ms: 523.0  |  critical path ms: 93.8  |  sequential ms: 522.8
+    // threads:  4  |  total ms: 136.4  |  critical path ms: 93.6  |  sequential ms: 520.2
+    // threads: 16  |  total ms: 94.8  |  critical path ms: 93.5  |  sequential ms: 519.9
+}
+
+
+int main() {
+    client();
+    benchmark();
+
+    return 0;
+}
@@ -3,25 +3,27 @@
 //
 
 #include <iostream>
-#include <string>
+#include <string_view>
 #include <memory>
 
 class Product {
 public:
     virtual ~Product() = default;
-    virtual std::string get_name_of_product() const  = 0;
+
+    // Names are literals, so a view to static storage is returned instead of a new string
+    virtual std::string_view get_name_of_product() const  = 0;
 };
 
 class Smartphone : public Product {
 public:
-    std::string get_name_of_product() const override {
+    std::string_view get_name_of_product() const override {
         return "Smartphone";
     }
 };
 
 class Laptop : public Product {
 public:
-    std::string get_name_of_product() const override {
+    std::string_view get_name_of_product() const override {
         return "Laptop";
     }
 };
@@ -0,0 +1,265 @@
+//
+// Factory Method with a thread-safe FactoryLikeCreator
+//
+// FactoryLikeCreator from FactoryMethod.cpp changes its counter without synchronization,
+// so the 2:1 smartphone/laptop ratio breaks when threads share one creator.
+// Here every product gets a number from one atomic sequence and the type is derived from
+// the number, so the ratio is exact whatever threads call the creator.
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+class Product {
+public:
+    virtual ~Product() = default;
+    virtual std::string_view get_name_of_product() const  = 0;
+};
+
+class Smartphone : public Product {
+public:
+    std::string_view get_name_of_product() const override {
+        return "Smartphone";
+    }
+};
+
+class Laptop : public Product {
+public:
+    std::string_view get_name_of_product() const override {
+        return "Laptop";
+    }
+};
+
+
+class Creator {
+public:
+    virtual ~Creator() = default;
+
+    // Factory Method
+    virtual std::unique_ptr<Product> create_object() = 0;
+};
+
+
+// creates laptop for every 2 smartphones, protected by mutex. Used as baseline
+class LockedFactoryLikeCreator : public Creator {
+public:
+    std::unique_ptr<Product> create_object() override {
+        bool laptop;
+        {
+            std::lock_guard lock(_mutex);
+            laptop = _counter == 2;
+            _counter = laptop ? 0 : _counter + 1;
+        }
+
+        if (laptop)
+            return std::make_unique<Laptop>();
+        return std::make_unique<Smartphone>();
+    }
+
+private:
+    std::mutex _mutex;
+    unsigned _counter = 0;
+};
+
+
+// creates laptop for every 2 smartphones, safe to share between threads
+class ConcurrentFactoryLikeCreator : public Creator {
+public:
+    struct SequenceRange {
+        std::uint64_t begin;
+        std::uint64_t end;
+    };
+
+    std::unique_ptr<Product> create_object() override {
+        return create_for(_sequence.fetch_add(1, std::memory_order_relaxed));
+    }
+
+    // Reserves `count` numbers at once, unused ones should be given back by release()
+    SequenceRange reserve(std::uint64_t count) {
+        std::uint64_t begin = _sequence.fetch_add(count, std::memory_order_relaxed);
+        return {begin, begin + count};
+    }
+
+    // Gives back unused numbers of a range. If nothing was taken from the sequence after
+    // the range, they go back to the sequence. Otherwise they are lost and only counted,
+    // so the ratio is exact over products made plus lost numbers.
+    void release(SequenceRange range) {
+        if (range.begin == range.end)
+            return;
+
+        std::uint64_t expected = range.end;
+        if (_sequence.compare_exchange_strong(expected, range.begin, std::memory_order_relaxed))
+            return;
+
+        _lost.fetch_add(range.end - range.begin, std::memory_order_relaxed);
+        _lost_laptops.fetch_add(laptops_below(range.end) - laptops_below(range.begin), std::memory_order_relaxed);
+    }
+
+    // Numbers taken from the sequence: used, lost or still reserved
+    std::uint64_t issued() const { return _sequence.load(std::memory_order_relaxed); }
+    std::uint64_t issued_laptops() const { return laptops_below(issued()); }
+
+    std::uint64_t lost() const { return _lost.load(std::memory_order_relaxed); }
+    std::uint64_t lost_laptops() const { return _lost_laptops.load(std::memory_order_relaxed); }
+
+    // Same order as FactoryLikeCreator: Smartphone, Smartphone, Laptop, ...
+    static std::unique_ptr<Product> create_for(std::uint64_t sequence) {
+        if (sequence % 3 == 2)
+            return std::make_unique<Laptop>();
+        return std::make_unique<Smartphone>();
+    }
+
+private:
+    // Laptops among numbers [0, sequence)
+    static std::uint64_t laptops_below(std::uint64_t sequence) { return sequence / 3; }
+
+    alignas(64) std::atomic<std::uint64_t> _sequence{0};
+    alignas(64) std::atomic<std::uint64_t> _lost{0};
+    std::atomic<std::uint64_t> _lost_laptops{0};
+};
+
+
+// Per-thread front end of the shared creator: touches the shared sequence once per range
+class RangeCreator : public Creator {
+public:
+    RangeCreator(ConcurrentFactoryLikeCreator& creator, std::uint64_t range_size)
+        : _creator(creator), _range_size(range_size) {}
+
+    RangeCreator(const RangeCreator&) = delete;
+    RangeCreator& operator=(const RangeCreator&) = delete;
+
+    ~RangeCreator() { _creator.release(_range); }
+
+    std::unique_ptr<Product> create_object() override {
+        if (_range.begin == _range.end)
+            _range = _creator.reserve(_range_size);
+
+        return ConcurrentFactoryLikeCreator::create_for(_range.begin++);
+    }
+
+private:
+    ConcurrentFactoryLikeCreator& _creator;
+    std::uint64_t _range_size;
+    ConcurrentFactoryLikeCreator::SequenceRange _range{0, 0};
+};
+
+
+struct ProductMix {
+    std::uint64_t smartphones = 0;
+    std::uint64_t laptops = 0;
+};
+
+
+// Every thread creates `per_thread` products through a creator made by `make_creator`
+template <typename MakeCreator>
+ProductMix create_in_threads(int threads_count, std::uint64_t per_thread, MakeCreator make_creator) {
+    std::vector<ProductMix> mixes(threads_count);
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < threads_count; ++t) {
+        threads.emplace_back([&, t] {
+            auto creator = make_creator();
+            ProductMix local;
+
+            for (std::uint64_t i = 0; i < per_thread; ++i) {
+                if (creator->create_object()->get_name_of_product() == "Laptop")
+                    ++local.laptops;
+                else
+                    ++local.smartphones;
+            }
+
+            mixes[t] = local;
+        });
+    }
+    for (auto& thread: threads)
+        thread.join();
+
+    ProductMix total;
+    for (const auto& mix: mixes) {
+        total.smartphones += mix.smartphones;
+        total.laptops += mix.laptops;
+    }
+    return total;
+}
+
+
+// Not owning pointer to a creator shared by all threads
+struct SharedCreator {
+    Creator* operator->() const { return creator; }
+    Creator* creator;
+};
+
+
+void client() {
+    constexpr int threads_count = 8;
+    constexpr std::uint64_t per_thread = 150 * 192;
+
+    ConcurrentFactoryLikeCreator shared;
+    ProductMix mix = create_in_threads(threads_count, per_thread, [&] { return SharedCreator{&shared}; });
+    std::cout << "shared creator  |  smartphones: " << mix.smartphones << ", laptops: " << mix.laptops
+              << ", exact: " << (mix.smartphones == 2 * mix.laptops) << '\n';
+
+    // per_thread is a multiple of the range size, so every reserved number is used
+    ConcurrentFactoryLikeCreator ranged;
+    mix = create_in_threads(threads_count, per_thread, [&] { return std::make_unique<RangeCreator>(ranged, 192); });
+    std::cout << "range creators  |  smartphones: " << mix.smartphones << ", laptops: " << mix.laptops
+              << ", exact: " << (mix.smartphones == 2 * mix.laptops) << '\n';
+
+    // Threads leave part of their last range unused. Depending on the order the threads finish,
+    // it goes back to the sequence or is lost, products and lost numbers together are exact anyway.
+    ConcurrentFactoryLikeCreator partial;
+    mix = create_in_threads(threads_count, 1000, [&] { return std::make_unique<RangeCreator>(partial, 192); });
+    bool exact = mix.smartphones + mix.laptops + partial.lost() == partial.issued()
+                 && mix.laptops + partial.lost_laptops() == partial.issued_laptops();
+    std::cout << "partial ranges  |  products: " << mix.smartphones + mix.laptops
+              << ", exact with lost numbers: " << exact << '\n';
+}
+
+//  OUTPUT
+//
+//  shared creator  |  smartphones: 153600, laptops: 76800, exact: 1
+//  range creators  |  smartphones: 153600, laptops: 76800, exact: 1
+//  partial ranges  |  products: 8000, exact with lost numbers: 1
+
+
+void benchmark() {
+    constexpr std::uint64_t products = 6'000'000;
+
+    std::cout << "\nproducts per second, " << products << " products" << '\n';
+
+    for (int threads_count: {1, 2, 4, 8}) {
+        std::uint64_t per_thread = products / threads_count;
+
+        auto measure = [&](auto make_creator) {
+            auto begin = std::chrono::steady_clock::now();
+            create_in_threads(threads_count, per_thread, make_creator);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+            return static_cast<std::uint64_t>(per_thread * threads_count / elapsed.count());
+        };
+
+        LockedFactoryLikeCreator locked;
+        ConcurrentFactoryLikeCreator atomic;
+        ConcurrentFactoryLikeCreator ranged;
+
+        std::cout << "threads: " << threads_count
+                  << "  |  mutex: " << measure([&] { return SharedCreator{&locked}; })
+                  << "  |  fetch_add: " << measure([&] { return SharedCreator{&atomic}; })
+                  << "  |  ranges of 192: " << measure([&] { return std::make_unique<RangeCreator>(ranged, 192); })
+                  << '\n';
+    }
+}
+
+
+int main() {
+    client();
+    benchmark();
+
+    return 0;
+}
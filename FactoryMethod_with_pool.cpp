@@ -0,0 +1,354 @@
+//
+// Factory Method with pooled creators
+//
+// Every create_object() of the plain creators is a heap allocation. Pooled creators take
+// memory from per-type free lists kept in a thread-local cache and return a unique_ptr
+// whose deleter puts the object back. Objects may be freed on any thread.
+//
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class Product {
+public:
+    virtual ~Product() = default;
+    virtual std::string_view get_name_of_product() const  = 0;
+};
+
+class Smartphone : public Product {
+public:
+    std::string_view get_name_of_product() const override {
+        return "Smartphone";
+    }
+};
+
+class Laptop : public Product {
+public:
+    std::string_view get_name_of_product() const override {
+        return "Laptop";
+    }
+};
+
+
+// Plain creators, the same as in FactoryMethod.cpp
+class Creator {
+public:
+    virtual ~Creator() = default;
+
+    // Factory Method
+    virtual std::unique_ptr<Product> create_object() = 0;
+};
+
+class SmartphoneCreator : public Creator {
+public:
+    std::unique_ptr<Product> create_object() override {
+        return std::make_unique<Smartphone>();
+    }
+};
+
+class LaptopCreator : public Creator {
+public:
+    std::unique_ptr<Product> create_object() override {
+        return std::make_unique<Laptop>();
+    }
+};
+
+// creates laptop for every 2 smartphones
+class FactoryLikeCreator : public Creator {
+public:
+    std::unique_ptr<Product> create_object() override {
+        if (_counter == 2) {
+            _counter = 0;
+            return std::make_unique<Laptop>();
+        }
+
+        _counter++;
+        return std::make_unique<Smartphone>();
+    }
+
+private:
+    unsigned _counter = 0;
+};
+
+
+// Memory for objects of type T. Every thread keeps its own free list, so allocation and
+// deallocation don't take locks. Objects freed on another thread go to that thread's list;
+// when a list grows too long, a batch of nodes is moved to the shared list, from where
+// other threads refill their lists. Slabs are returned to the system at program exit.
+template <typename T>
+class ProductPool {
+public:
+    static void* allocate() {
+        ThreadCache& local = cache;
+        if (local.free == nullptr)
+            refill(local);
+
+        Node* node = local.free;
+        local.free = node->next;
+        --local.size;
+        return node;
+    }
+
+    static void deallocate(void* pointer) {
+        ThreadCache& local = cache;
+
+        auto* node = static_cast<Node*>(pointer);
+        node->next = local.free;
+        local.free = node;
+
+        if (++local.size > cache_limit)
+            release(local, batch_size);
+    }
+
+private:
+    union Node {
+        Node* next;
+        alignas(T) std::byte storage[sizeof(T)];
+    };
+
+    static constexpr std::size_t slab_size = 1024;
+    static constexpr std::size_t batch_size = 512;
+    static constexpr std::size_t cache_limit = 4 * batch_size;
+
+    struct Shared {
+        std::mutex mutex;
+        Node* free = nullptr;
+        std::vector<std::unique_ptr<Node[]>> slabs;
+    };
+
+    struct ThreadCache {
+        ~ThreadCache() { release(*this, size); }
+
+        Node* free = nullptr;
+        std::size_t size = 0;
+    };
+
+    static void refill(ThreadCache& local) {
+        std::lock_guard lock(shared.mutex);
+
+        while (shared.free != nullptr && local.size < batch_size) {
+            Node* node = shared.free;
+            shared.free = node->next;
+            node->next = local.free;
+            local.free = node;
+            ++local.size;
+        }
+
+        if (local.free != nullptr)
+            return;
+
+        auto& slab = shared.slabs.emplace_back(std::make_unique<Node[]>(slab_size));
+        for (std::size_t i = 0; i < slab_size; ++i)
+            slab[i].next = i + 1 < slab_size ? &slab[i + 1] : nullptr;
+        local.free = &slab[0];
+        local.size = slab_size;
+    }
+
+    static void release(ThreadCache& local, std::size_t count) {
+        std::lock_guard lock(shared.mutex);
+
+        for (; count > 0 && local.free != nullptr; --count) {
+            Node* node = local.free;
+            local.free = node->next;
+            node->next = shared.free;
+            shared.free = node;
+            --local.size;
+        }
+    }
+
+    static inline Shared shared{};
+    static inline thread_local ThreadCache cache{};
+};
+
+
+// Deleter remembers how to recycle the concrete type, so one pointer type fits all products
+struct ProductDeleter {
+    void (*recycle)(Product*) = nullptr;
+
+    void operator()(Product* product) const { recycle(product); }
+};
+
+using PooledProduct = std::unique_ptr<Product, ProductDeleter>;
+
+
+template <typename T>
+requires std::is_base_of_v<Product, T>
+PooledProduct make_pooled() {
+    void* memory = ProductPool<T>::allocate();
+    T* product;
+
+    try {
+        product = ::new (memory) T();
+    }
+    catch (...) {
+        ProductPool<T>::deallocate(memory);
+        throw;
+    }
+
+    return PooledProduct(product, ProductDeleter{[](Product* object) {
+        auto* concrete = static_cast<T*>(object);
+        concrete->~T();
+        ProductPool<T>::deallocate(concrete);
+    }});
+}
+
+
+class PooledCreator {
+public:
+    virtual ~PooledCreator() = default;
+
+    // Factory Method
+    virtual PooledProduct create_object() = 0;
+};
+
+class PooledSmartphoneCreator : public PooledCreator {
+public:
+    PooledProduct create_object() override {
+        return make_pooled<Smartphone>();
+    }
+};
+
+class PooledLaptopCreator : public PooledCreator {
+public:
+    PooledProduct create_object() override {
+        return make_pooled<Laptop>();
+    }
+};
+
+// creates laptop for every 2 smartphones
+class PooledFactoryLikeCreator : public PooledCreator {
+public:
+    PooledProduct create_object() override {
+        if (_counter == 2) {
+            _counter = 0;
+            return make_pooled<Laptop>();
+        }
+
+        _counter++;
+        return make_pooled<Smartphone>();
+    }
+
+private:
+    unsigned _counter = 0;
+};
+
+
+void client() {
+    std::unique_ptr<PooledCreator> factor_creator = std::make_unique<PooledFactoryLikeCreator>();
+
+    const Product* previous = nullptr;
+    for (int i = 0; i < 4; ++i) {
+        PooledProduct product = factor_creator->create_object();
+        std::cout << "i = " << i << "; Product: " << product->get_name_of_product()
+                  << "; reused memory: " << (product.get() == previous) << '\n';
+        previous = product.get();
+    }
+}
+
+//  OUTPUT
+//
+//  i = 0; Product: Smartphone; reused memory: 0
+//  i = 1; Product: Smartphone; reused memory: 1
+//  i = 2; Product: Laptop; reused memory: 0
+//  i = 3; Product: Smartphone; reused memory: 0
+
+
+// Creates and destroys products on one thread, keeping `alive` of them at once
+template <typename CreatorType>
+double single_thread(int products, int alive) {
+    CreatorType creator;
+    std::vector<decltype(creator.create_object())> held(alive);
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < products; ++i)
+        held[i % alive] = creator.create_object();
+    held.clear();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+    return products / elapsed.count();
+}
+
+
+// Products are created on one thread and destroyed on another
+template <typename CreatorType>
+double cross_thread(int products) {
+    constexpr int batch = 1024;
+
+    CreatorType creator;
+    using Batch = std::vector<decltype(creator.create_object())>;
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<Batch> batches;
+    bool done = false;
+
+    auto begin = std::chrono::steady_clock::now();
+
+    std::thread consumer([&] {
+        for (;;) {
+            std::unique_lock lock(mutex);
+            ready.wait(lock, [&] { return !batches.empty() || done; });
+            if (batches.empty())
+                return;
+
+            Batch current = std::move(batches.front());
+            batches.pop_front();
+            lock.unlock();
+
+            current.clear();
+        }
+    });
+
+    for (int i = 0; i < products; i += batch) {
+        Batch current;
+        current.reserve(batch);
+        for (int j = 0; j < batch; ++j)
+            current.push_back(creator.create_object());
+
+        std::lock_guard lock(mutex);
+        batches.push_back(std::move(current));
+        ready.notify_one();
+    }
+
+    {
+        std::lock_guard lock(mutex);
+        done = true;
+        ready.notify_one();
+    }
+    consumer.join();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    return products / elapsed.count();
+}
+
+
+void benchmark() {
+    constexpr int products = 10'000'000;
+
+    std::cout << "\nproducts per second, " << products << " products" << '\n';
+    std::cout << "single thread, 1 alive      |  plain: " << static_cast<long>(single_thread<FactoryLikeCreator>(products, 1))
+              << "  |  pooled: " << static_cast<long>(single_thread<PooledFactoryLikeCreator>(products, 1)) << '\n';
+    std::cout << "single thread, 10000 alive  |  plain: " << static_cast<long>(single_thread<FactoryLikeCreator>(products, 10'000))
+              << "  |  pooled: " << static_cast<long>(single_thread<PooledFactoryLikeCreator>(products, 10'000)) << '\n';
+    std::cout << "freed on another thread     |  plain: " << static_cast<long>(cross_thread<FactoryLikeCreator>(products))
+              << "  |  pooled: " << static_cast<long>(cross_thread<PooledFactoryLikeCreator>(products)) << '\n';
+}
+
+
+int main() {
+    client();
+    benchmark();
+
+    return 0;
+}
@@ -0,0 +1,248 @@
+//
+// Factory Method with contiguous product storage
+//
+// Products kept as unique_ptr<Product> are scattered over the heap, and every call
+// goes through the vtable. ProductStorage keeps products of every concrete type in its
+// own contiguous array, so iteration walks arrays and calls are resolved statically.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <span>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class Product {
+public:
+    virtual ~Product() = default;
+
+    // Names are literals, so a view to static storage is returned instead of a new string
+    virtual std::string_view get_name_of_product() const  = 0;
+};
+
+// final lets the compiler call methods directly when the concrete type is known
+class Smartphone final : public Product {
+public:
+    std::string_view get_name_of_product() const override {
+        return "Smartphone";
+    }
+};
+
+class Laptop final : public Product {
+public:
+    std::string_view get_name_of_product() const override {
+        return "Laptop";
+    }
+};
+
+
+// One vector per concrete type. for_each() visits types one after another and passes
+// concrete references, so the visitor is instantiated per type without virtual calls.
+template <typename... Products>
+requires (std::is_base_of_v<Product, Products> && ...)
+class ProductStorage {
+public:
+    // Position of a product. Unlike a reference, it stays valid when the storage grows.
+    struct Handle {
+        std::size_t type;   // position of the product type in Products...
+        std::size_t index;
+    };
+
+    template <typename T, typename... Args>
+    Handle emplace(Args&&... args) {
+        auto& products = storage<T>();
+        products.emplace_back(std::forward<Args>(args)...);
+        return {type_index<T>, products.size() - 1};
+    }
+
+    // Reference is valid until the next emplace of a product of the same type
+    Product& operator[](Handle handle) {
+        Product* product = nullptr;
+        std::size_t type = 0;
+        ((type++ == handle.type ? void(product = &storage<Products>()[handle.index]) : void()), ...);
+        return *product;
+    }
+
+    const Product& operator[](Handle handle) const { return const_cast<ProductStorage&>(*this)[handle]; }
+
+    template <typename T>
+    void reserve(std::size_t count) { storage<T>().reserve(count); }
+
+    template <typename T>
+    std::span<T> of() { return storage<T>(); }
+
+    template <typename T>
+    std::span<const T> of() const { return std::get<std::vector<T>>(_storage); }
+
+    template <typename Visitor>
+    void for_each(Visitor&& visitor) const {
+        (for_each_of<Products>(visitor), ...);
+    }
+
+    template <typename T, typename Visitor>
+    void for_each_of(Visitor&& visitor) const {
+        for (const T& product: std::get<std::vector<T>>(_storage))
+            visitor(product);
+    }
+
+    std::size_t size() const {
+        return (std::get<std::vector<Products>>(_storage).size() + ...);
+    }
+
+private:
+    template <typename T>
+    static constexpr std::size_t type_index = [] {
+        std::size_t index = 0;
+        ((!std::is_same_v<T, Products> && (++index, true)) && ...);
+        return index;
+    }();
+
+    template <typename T>
+    std::vector<T>& storage() { return std::get<std::vector<T>>(_storage); }
+
+    std::tuple<std::vector<Products>...> _storage;
+};
+
+using Products = ProductStorage<Smartphone, Laptop>;
+
+
+class Creator {
+public:
+    virtual ~Creator() = default;
+
+    // Factory Method
+    virtual std::unique_ptr<Product> create_object() = 0;
+
+    // Same product, placed into the storage instead of a separate heap node.
+    // Returns a handle, a reference would dangle when the storage grows.
+    virtual Products::Handle create_object(Products& storage) = 0;
+};
+
+// creates laptop for every 2 smartphones
+class FactoryLikeCreator : public Creator {
+public:
+    std::unique_ptr<Product> create_object() override {
+        if (next_is_laptop())
+            return std::make_unique<Laptop>();
+        return std::make_unique<Smartphone>();
+    }
+
+    Products::Handle create_object(Products& storage) override {
+        if (next_is_laptop())
+            return storage.emplace<Laptop>();
+        return storage.emplace<Smartphone>();
+    }
+
+private:
+    bool next_is_laptop() {
+        if (_counter == 2) {
+            _counter = 0;
+            return true;
+        }
+
+        _counter++;
+        return false;
+    }
+
+    unsigned _counter = 0;
+};
+
+
+void client() {
+    FactoryLikeCreator creator;
+    Products storage;
+
+    Products::Handle first = creator.create_object(storage);
+    for (int i = 0; i < 5; ++i)
+        creator.create_object(storage);
+
+    // Products are grouped by type
+    storage.for_each([](const auto& product) {
+        std::cout << "Product: " << product.get_name_of_product() << '\n';
+    });
+
+    std::cout << "Laptops: " << storage.of<Laptop>().size() << '\n';
+
+    // Handle is still valid after the storage grew
+    std::cout << "First: " << storage[first].get_name_of_product() << '\n';
+}
+
+//  OUTPUT
+//
+//  Product: Smartphone
+//  Product: Smartphone
+//  Product: Smartphone
+//  Product: Smartphone
+//  Product: Laptop
+//  Product: Laptop
+//  Laptops: 2
+//  First: Smartphone
+
+
+// Keeps compiler from folding the loop over products into one multiplication
+template <typename T>
+void do_not_optimize(const T& value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+
+void benchmark() {
+    constexpr std::size_t products = 10'000'000;
+    constexpr int passes = 5;
+
+    FactoryLikeCreator creator;
+
+    // Heap nodes are shuffled, as they are in a long living program
+    std::vector<std::unique_ptr<Product>> scattered;
+    scattered.reserve(products);
+    for (std::size_t i = 0; i < products; ++i)
+        scattered.push_back(creator.create_object());
+    std::shuffle(scattered.begin(), scattered.end(), std::mt19937_64{42});
+
+    Products storage;
+    storage.reserve<Smartphone>(products);
+    storage.reserve<Laptop>(products / 2);
+    for (std::size_t i = 0; i < products; ++i)
+        creator.create_object(storage);
+
+    std::size_t scattered_length = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; ++pass) {
+        for (const auto& product: scattered) {
+            scattered_length += product->get_name_of_product().size();
+            do_not_optimize(*product);
+        }
+    }
+    std::chrono::duration<double, std::nano> scattered_time = std::chrono::steady_clock::now() - begin;
+
+    std::size_t contiguous_length = 0;
+    begin = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; ++pass) {
+        storage.for_each([&](const auto& product) {
+            contiguous_length += product.get_name_of_product().size();
+            do_not_optimize(product);
+        });
+    }
+    std::chrono::duration<double, std::nano> contiguous_time = std::chrono::steady_clock::now() - begin;
+
+    std::cout << "\niteration over " << products << " products, ns per product" << '\n';
+    std::cout << "vector<unique_ptr<Product>>  |  " << scattered_time.count() / (passes * products)
+              << "  (length " << scattered_length << ")" << '\n';
+    std::cout << "ProductStorage               |  " << contiguous_time.count() / (passes * products)
+              << "  (length " << contiguous_length << ")" << '\n';
+}
+
+
+int main() {
+    client();
+    benchmark();
+
+    return 0;
+}
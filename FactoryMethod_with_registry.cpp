@@ -0,0 +1,346 @@
+//
+// Factory Method with batch creation and creator registry
+//
+// create_batch() builds many products at once: concrete creators place them into one
+// contiguous block, so virtual dispatch and allocation are paid once per batch.
+// CreatorRegistry finds creators by name through a perfect hash built at startup.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class Product {
+public:
+    virtual ~Product() = default;
+    virtual std::string_view get_name_of_product() const  = 0;
+};
+
+class Smartphone : public Product {
+public:
+    std::string_view get_name_of_product() const override {
+        return "Smartphone";
+    }
+};
+
+class Laptop : public Product {
+public:
+    std::string_view get_name_of_product() const override {
+        return "Laptop";
+    }
+};
+
+
+// Owns products created in batches. Products of one block lie in one array,
+// the batch keeps pointers to them in creation order.
+class ProductBatch {
+public:
+    template <typename T>
+    requires std::is_base_of_v<Product, T> && std::is_default_constructible_v<T>
+    T* emplace_block(std::size_t count) {
+        // Owned here until _blocks has room for it
+        std::unique_ptr<T[]> block(new T[count]);
+        _blocks.emplace_back(block.get(), [](void* pointer) { delete[] static_cast<T*>(pointer); });
+        return block.release();
+    }
+
+    // Products created one by one are kept too
+    void adopt(std::unique_ptr<Product> product) {
+        _blocks.emplace_back(product.get(), [](void* pointer) { delete static_cast<Product*>(pointer); });
+        _products.push_back(product.release());
+    }
+
+    void push_back(Product* product) { _products.push_back(product); }
+
+    // Makes room for `count` more products. Grows at least twice, so many small batches
+    // don't reallocate on every call.
+    void reserve(std::size_t count) {
+        std::size_t needed = _products.size() + count;
+        if (needed > _products.capacity())
+            _products.reserve(std::max(needed, 2 * _products.capacity()));
+    }
+
+    Product& operator[](std::size_t index) const { return *_products[index]; }
+    std::size_t size() const { return _products.size(); }
+
+    auto begin() const { return _products.begin(); }
+    auto end() const { return _products.end(); }
+
+private:
+    std::vector<Product*> _products;
+    std::vector<std::unique_ptr<void, void (*)(void*)>> _blocks;
+};
+
+
+class Creator {
+public:
+    virtual ~Creator() = default;
+
+    // Factory Method
+    virtual std::unique_ptr<Product> create_object() = 0;
+
+    // Creates `count` products and appends them to `out`. By default calls create_object()
+    virtual void create_batch(std::size_t count, ProductBatch& out) {
+        out.reserve(count);
+        for (std::size_t i = 0; i < count; ++i)
+            out.adopt(create_object());
+    }
+};
+
+
+template <typename T>
+void fill_block(std::size_t count, ProductBatch& out) {
+    T* block = out.emplace_block<T>(count);
+    out.reserve(count);
+    for (std::size_t i = 0; i < count; ++i)
+        out.push_back(block + i);
+}
+
+class SmartphoneCreator : public Creator {
+public:
+    std::unique_ptr<Product> create_object() override {
+        return std::make_unique<Smartphone>();
+    }
+
+    void create_batch(std::size_t count, ProductBatch& out) override {
+        fill_block<Smartphone>(count, out);
+    }
+};
+
+class LaptopCreator : public Creator {
+public:
+    std::unique_ptr<Product> create_object() override {
+        return std::make_unique<Laptop>();
+    }
+
+    void create_batch(std::size_t count, ProductBatch& out) override {
+        fill_block<Laptop>(count, out);
+    }
+};
+
+// creates laptop for every 2 smartphones
+class FactoryLikeCreator : public Creator {
+public:
+    std::unique_ptr<Product> create_object() override {
+        if (_counter == 2) {
+            _counter = 0;
+            return std::make_unique<Laptop>();
+        }
+
+        _counter++;
+        return std::make_unique<Smartphone>();
+    }
+
+    // One block per product type, order of products is the same as with create_object()
+    void create_batch(std::size_t count, ProductBatch& out) override {
+        std::size_t laptops = (count + _counter) / 3;
+        std::size_t smartphones = count - laptops;
+
+        Smartphone* smartphone = smartphones ? out.emplace_block<Smartphone>(smartphones) : nullptr;
+        Laptop* laptop = laptops ? out.emplace_block<Laptop>(laptops) : nullptr;
+
+        out.reserve(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            if (_counter == 2) {
+                _counter = 0;
+                out.push_back(laptop++);
+            }
+            else {
+                _counter++;
+                out.push_back(smartphone++);
+            }
+        }
+    }
+
+private:
+    unsigned _counter = 0;
+};
+
+
+// Registry of creators, built once. Names are placed into a table by a seeded hash;
+// the seed is chosen at startup so that no two names collide, which makes lookup
+// one hash, one probe and one comparison. Creators can also be addressed by id.
+class CreatorRegistry {
+public:
+    using CreatorId = std::uint32_t;
+
+    struct Entry {
+        std::string name;
+        std::unique_ptr<Creator> creator;
+    };
+
+    explicit CreatorRegistry(std::vector<Entry> entries)
+            : _entries(std::move(entries)) {
+        std::size_t table_size = 1;
+        while (table_size < 2 * _entries.size())
+            table_size *= 2;
+
+        for (;; table_size *= 2) {
+            _mask = table_size - 1;
+            for (_seed = 0; _seed < max_seed; ++_seed) {
+                if (try_build(table_size))
+                    return;
+            }
+        }
+    }
+
+    static constexpr CreatorId npos = static_cast<CreatorId>(-1);
+
+    CreatorId id_of(std::string_view name) const {
+        CreatorId id = _table[hash(name, _seed) & _mask];
+        return id != npos && _entries[id].name == name ? id : npos;
+    }
+
+    Creator& get(CreatorId id) const { return *_entries[id].creator; }
+
+    Creator& get(std::string_view name) const {
+        CreatorId id = id_of(name);
+        if (id == npos)
+            throw std::out_of_range("Unknown creator: " + std::string(name));
+        return get(id);
+    }
+
+    std::size_t size() const { return _entries.size(); }
+
+private:
+    static constexpr std::uint64_t max_seed = 1024;
+
+    // FNV-1a mixed with seed
+    static std::uint64_t hash(std::string_view key, std::uint64_t seed) {
+        std::uint64_t result = 14695981039346656037ull ^ (seed * 0x9E3779B97F4A7C15ull);
+        for (char symbol: key) {
+            result ^= static_cast<unsigned char>(symbol);
+            result *= 1099511628211ull;
+        }
+        return result ^ (result >> 32);
+    }
+
+    bool try_build(std::size_t table_size) {
+        _table.assign(table_size, npos);
+
+        for (CreatorId id = 0; id < _entries.size(); ++id) {
+            CreatorId& slot = _table[hash(_entries[id].name, _seed) & _mask];
+            if (slot != npos) {
+                if (_entries[slot].name == _entries[id].name)
+                    throw std::invalid_argument("Duplicate creator: " + _entries[id].name);
+                return false;
+            }
+            slot = id;
+        }
+
+        return true;
+    }
+
+    std::vector<Entry> _entries;
+    std::vector<CreatorId> _table;
+    std::uint64_t _seed = 0;
+    std::uint64_t _mask = 0;
+};
+
+
+CreatorRegistry make_registry() {
+    std::vector<CreatorRegistry::Entry> entries;
+    entries.push_back({"smartphone", std::make_unique<SmartphoneCreator>()});
+    entries.push_back({"laptop", std::make_unique<LaptopCreator>()});
+    entries.push_back({"factory_like", std::make_unique<FactoryLikeCreator>()});
+
+    return CreatorRegistry{std::move(entries)};
+}
+
+
+void client() {
+    CreatorRegistry registry = make_registry();
+
+    ProductBatch batch;
+    registry.get("factory_like").create_batch(5, batch);
+    registry.get("laptop").create_batch(1, batch);
+
+    for (std::size_t i = 0; i < batch.size(); ++i)
+        std::cout << "i = " << i << "; Product: " << batch[i].get_name_of_product() << '\n';
+
+    std::cout << "Unknown creator id: " << (registry.id_of("tablet") == CreatorRegistry::npos) << '\n';
+}
+
+//  OUTPUT
+//
+//  i = 0; Product: Smartphone
+//  i = 1; Product: Smartphone
+//  i = 2; Product: Laptop
+//  i = 3; Product: Smartphone
+//  i = 4; Product: Smartphone
+//  i = 5; Product: Laptop
+//  Unknown creator id: 1
+
+
+void benchmark() {
+    constexpr std::size_t products = 10'000'000;
+
+    CreatorRegistry registry = make_registry();
+    Creator& creator = registry.get("factory_like");
+
+    std::cout << "\nproducts per second, " << products << " products" << '\n';
+
+    auto begin = std::chrono::steady_clock::now();
+    {
+        std::vector<std::unique_ptr<Product>> single;
+        single.reserve(products);
+        for (std::size_t i = 0; i < products; ++i)
+            single.push_back(creator.create_object());
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    std::cout << "create_object      |  " << static_cast<std::uint64_t>(products / elapsed.count()) << '\n';
+
+    for (std::size_t batch_size: {1, 16, 256, 4096}) {
+        begin = std::chrono::steady_clock::now();
+        {
+            ProductBatch batch;
+            for (std::size_t i = 0; i < products; i += batch_size)
+                creator.create_batch(batch_size, batch);
+        }
+        elapsed = std::chrono::steady_clock::now() - begin;
+        std::cout << "create_batch(" << batch_size << ")" << std::string(5 - std::to_string(batch_size).size(), ' ')
+                  << "|  " << static_cast<std::uint64_t>(products / elapsed.count()) << '\n';
+    }
+
+    // Lookups
+    constexpr std::size_t lookups = 10'000'000;
+    const std::string_view names[] = {"smartphone", "laptop", "factory_like", "tablet"};
+
+    std::unordered_map<std::string, Creator*> map;
+    for (auto name: names)
+        if (registry.id_of(name) != CreatorRegistry::npos)
+            map.emplace(name, &registry.get(name));
+
+    std::size_t found = 0;
+    begin = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < lookups; ++i)
+        found += registry.id_of(names[i & 3]) != CreatorRegistry::npos;
+    std::chrono::duration<double> perfect = std::chrono::steady_clock::now() - begin;
+
+    begin = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < lookups; ++i)
+        found += map.find(std::string(names[i & 3])) != map.end();
+    std::chrono::duration<double> hashed = std::chrono::steady_clock::now() - begin;
+
+    std::cout << "\nlookups per second" << '\n';
+    std::cout << "perfect hash   |  " << static_cast<std::uint64_t>(lookups / perfect.count()) << '\n';
+    std::cout << "unordered_map  |  " << static_cast<std::uint64_t>(lookups / hashed.count())
+              << "  (found " << found << ")" << '\n';
+}
+
+
+int main() {
+    client();
+    benchmark();
+
+    return 0;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+/*
+ * Heap usage counter for benchmarks
+ *
+ * Replaces every form of global operator new and delete, plain, array, sized and aligned,
+ * to count allocations, allocated bytes and bytes in use on the heap. Defines non-inline
+ * functions, so include it in one translation unit of an executable only.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+
+namespace heap_usage {
+
+namespace detail {
+
+inline std::atomic<std::size_t> allocations{0};
+inline std::atomic<std::size_t> allocated_bytes{0};
+inline std::atomic<std::size_t> live_bytes{0};
+
+// Not inlined into operators, otherwise GCC sees free() of a pointer from operator new
+// and warns about mismatched allocation functions
+[[gnu::noinline]] inline void* allocate(std::size_t size, std::size_t alignment = 0) {
+    size = size == 0 ? 1 : size;
+    void* pointer = alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__
+                        ? std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)
+                        : std::malloc(size);
+    if (pointer == nullptr)
+        throw std::bad_alloc();
+
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    live_bytes.fetch_add(malloc_usable_size(pointer), std::memory_order_relaxed);
+    return pointer;
+}
+
+[[gnu::noinline]] inline void release(void* pointer) noexcept {
+    if (pointer == nullptr)
+        return;
+    live_bytes.fetch_sub(malloc_usable_size(pointer), std::memory_order_relaxed);
+    std::free(pointer);
+}
+
+}
+
+// Calls of operator new since the start
+inline std::size_t allocations() { return detail::allocations.load(std::memory_order_relaxed); }
+
+// Bytes requested from operator new since the start, freed ones too
+inline std::size_t allocated_bytes() { return detail::allocated_bytes.load(std::memory_order_relaxed); }
+
+// Bytes in use, as malloc sees them, so with its rounding up
+inline std::size_t live_bytes() { return detail::live_bytes.load(std::memory_order_relaxed); }
+
+}
+
+
+void* operator new(std::size_t size) { return heap_usage::detail::allocate(size); }
+void* operator new[](std::size_t size) { return heap_usage::detail::allocate(size); }
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return heap_usage::detail::allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return heap_usage::detail::allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* pointer) noexcept { heap_usage::detail::release(pointer); }
+void operator delete[](void* pointer) noexcept { heap_usage::detail::release(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { heap_usage::detail::release(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { heap_usage::detail::release(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { heap_usage::detail::release(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { heap_usage::detail::release(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { heap_usage::detail::release(pointer); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { heap_usage::detail::release(pointer); }
@@ -0,0 +1,229 @@
+//
+// Counting of copies, moves and allocations for auditing hot paths of the patterns
+//
+// Every thread adds to its own counters, a Scope sums them over all threads (or reads
+// the current thread only) at its start and on request, and reports the difference.
+// Counted is a member or base that counts copies and moves of its owner (and its heap
+// allocations, as a base), Tracked<T> wraps any type with it, and CountingAllocator counts
+// allocations of a container.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+namespace instrumentation {
+
+struct Counters {
+    std::uint64_t copies = 0;
+    std::uint64_t moves = 0;
+    std::uint64_t allocations = 0;
+    std::uint64_t bytes = 0;
+
+    Counters& operator+=(const Counters& other) {
+        copies += other.copies;
+        moves += other.moves;
+        allocations += other.allocations;
+        bytes += other.bytes;
+        return *this;
+    }
+
+    friend Counters operator-(Counters left, const Counters& right) {
+        left.copies -= right.copies;
+        left.moves -= right.moves;
+        left.allocations -= right.allocations;
+        left.bytes -= right.bytes;
+        return left;
+    }
+
+    friend std::ostream& operator<<(std::ostream& output, const Counters& counters) {
+        output << "copies: " << counters.copies << "  |  moves: " << counters.moves
+               << "  |  allocations: " << counters.allocations << "  |  bytes: " << counters.bytes;
+        return output;
+    }
+};
+
+
+namespace detail {
+
+// Counters of one thread. Only the owner writes them, so an update is a relaxed load
+// and store, not a locked instruction. Other threads only read them.
+struct ThreadCounters {
+    std::atomic<std::uint64_t> copies{0};
+    std::atomic<std::uint64_t> moves{0};
+    std::atomic<std::uint64_t> allocations{0};
+    std::atomic<std::uint64_t> bytes{0};
+
+    static void add(std::atomic<std::uint64_t>& counter, std::uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    Counters load() const {
+        return {copies.load(std::memory_order_relaxed), moves.load(std::memory_order_relaxed),
+                allocations.load(std::memory_order_relaxed), bytes.load(std::memory_order_relaxed)};
+    }
+};
+
+
+// Knows counters of all live threads and keeps the sum of finished ones
+class Registry {
+public:
+    static Registry& instance() {
+        static Registry registry;
+        return registry;
+    }
+
+    void attach(ThreadCounters* counters) {
+        std::lock_guard lock(_mutex);
+        _threads.push_back(counters);
+    }
+
+    void detach(ThreadCounters* counters) {
+        std::lock_guard lock(_mutex);
+        _finished += counters->load();
+        _threads.erase(std::find(_threads.begin(), _threads.end(), counters));
+    }
+
+    Counters total() const {
+        std::lock_guard lock(_mutex);
+        Counters total = _finished;
+        for (const auto* counters: _threads)
+            total += counters->load();
+        return total;
+    }
+
+private:
+    mutable std::mutex _mutex;
+    std::vector<ThreadCounters*> _threads;
+    Counters _finished;
+};
+
+
+struct ThreadSlot {
+    ThreadSlot() { Registry::instance().attach(&counters); }
+    ~ThreadSlot() { Registry::instance().detach(&counters); }
+
+    ThreadCounters counters;
+};
+
+
+inline ThreadCounters& local() {
+    thread_local ThreadSlot slot;
+    return slot.counters;
+}
+
+}   // namespace detail
+
+
+inline void count_copy() { detail::ThreadCounters::add(detail::local().copies, 1); }
+inline void count_move() { detail::ThreadCounters::add(detail::local().moves, 1); }
+
+inline void count_allocation(std::uint64_t bytes) {
+    auto& counters = detail::local();
+    detail::ThreadCounters::add(counters.allocations, 1);
+    detail::ThreadCounters::add(counters.bytes, bytes);
+}
+
+
+// Counts what happened since construction
+class Scope {
+public:
+    enum class Threads { Current, All };
+
+    explicit Scope(Threads threads = Threads::All)
+        : _threads(threads), _start(snapshot()) {}
+
+    Counters counters() const { return snapshot() - _start; }
+
+    void restart() { _start = snapshot(); }
+
+    // One line for the benchmark output, counters are divided by the number of operations:
+    // name  |  copies/op: 1  |  moves/op: 0  |  allocations/op: 1  |  bytes/op: 32
+    void report(std::ostream& output, std::string_view name, std::uint64_t operations = 1) const {
+        Counters counters = this->counters();
+        auto per_operation = [&](std::uint64_t value) { return static_cast<double>(value) / operations; };
+
+        output << name << "  |  copies/op: " << per_operation(counters.copies)
+               << "  |  moves/op: " << per_operation(counters.moves)
+               << "  |  allocations/op: " << per_operation(counters.allocations)
+               << "  |  bytes/op: " << per_operation(counters.bytes) << '\n';
+    }
+
+private:
+    Counters snapshot() const {
+        if (_threads == Threads::Current)
+            return detail::local().load();
+        return detail::Registry::instance().total();
+    }
+
+    Threads _threads;
+    Counters _start;
+};
+
+
+// Member or base which counts copies and moves of its owner. When it is a base,
+// heap allocations of the owner with new are counted too.
+struct Counted {
+    Counted() = default;
+    Counted(const Counted&) noexcept { count_copy(); }
+    Counted(Counted&&) noexcept { count_move(); }
+    Counted& operator=(const Counted&) noexcept { count_copy(); return *this; }
+    Counted& operator=(Counted&&) noexcept { count_move(); return *this; }
+
+    static void* operator new(std::size_t size) {
+        count_allocation(size);
+        return ::operator new(size);
+    }
+
+    static void operator delete(void* pointer) noexcept { ::operator delete(pointer); }
+};
+
+
+// Value of any type whose copies and moves are counted
+template <typename T>
+struct Tracked {
+    Tracked() = default;
+    explicit Tracked(T value)
+        : value(std::move(value)) {}
+
+    static void* operator new(std::size_t size) { return Counted::operator new(size); }
+    static void operator delete(void* pointer) noexcept { Counted::operator delete(pointer); }
+
+    T value;
+    [[no_unique_address]] Counted counted;
+};
+
+
+// Standard allocator which counts allocations and bytes
+template <typename T>
+struct CountingAllocator {
+    using value_type = T;
+
+    CountingAllocator() = default;
+
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t count) {
+        count_allocation(count * sizeof(T));
+        return std::allocator<T>{}.allocate(count);
+    }
+
+    void deallocate(T* pointer, std::size_t count) noexcept {
+        std::allocator<T>{}.deallocate(pointer, count);
+    }
+
+    template <typename U>
+    friend bool operator==(const CountingAllocator&, const CountingAllocator<U>&) { return true; }
+};
+
+}   // namespace instrumentation
@@ -6,7 +6,6 @@
  */
 
 #include <iostream>
-#include <memory>
 
 enum class Events { A, B };
 
@@ -28,11 +27,12 @@ public:
 
 
     void set_mediator(Mediator* mediator) {
-        _mediator.reset(mediator);
+        _mediator = mediator;
     }
 
 protected:
-    std::unique_ptr<Mediator> _mediator;
+    // Mediator is shared between components and outlives them, so components don't own it
+    Mediator* _mediator;
 };
 
 
@@ -0,0 +1,296 @@
+/*
+ * Mediator pattern: pooled component registry
+ *
+ * Intent: same as in Mediator.cpp. Here the mediator also owns its components: they live
+ * in slab pools and are referenced by generation-checked handles instead of raw pointers,
+ * so components can be attached and detached at high rate without heap allocations.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "HeapUsage.h"
+
+enum class Events { A, B };
+
+
+class Component;
+
+
+class Mediator {
+public:
+    virtual ~Mediator() = default;
+
+    virtual void notify(Component& sender, Events event) = 0;
+};
+
+
+class Component {
+public:
+    explicit Component(Mediator* mediator = nullptr) : _mediator(mediator) {}
+
+    void set_mediator(Mediator* mediator) { _mediator = mediator; }
+
+protected:
+    // Not owning: the mediator owns components, not the other way around
+    Mediator* _mediator;
+};
+
+
+class ConcreteComponentA : public Component {
+public:
+    using Component::Component;
+
+    void do_logic() { ++_handled; }
+    void do_b() { _mediator->notify(*this, Events::B); }
+
+    std::uint64_t handled() const { return _handled; }
+
+private:
+    std::uint64_t _handled = 0;
+};
+
+
+class ConcreteComponentB : public Component {
+public:
+    using Component::Component;
+
+    void do_logic() { ++_handled; }
+    void do_a() { _mediator->notify(*this, Events::A); }
+
+    std::uint64_t handled() const { return _handled; }
+
+private:
+    std::uint64_t _handled = 0;
+};
+
+
+// Handle stays valid until the component is detached. After that the slot generation
+// changes and lookup by an old handle returns nullptr even if the slot was reused.
+template <typename T>
+struct Handle {
+    std::uint32_t index = std::numeric_limits<std::uint32_t>::max();
+    std::uint32_t generation = 0;
+};
+
+
+// Objects are stored in fixed size slabs, free slots are linked into a list. Memory is only
+// allocated when all slabs are full, attach/detach in steady state are O(1) and allocation free.
+template <typename T, std::size_t SlabSize = 4096>
+class Pool {
+public:
+    Pool() = default;
+
+    Pool(const Pool&) = delete;
+    Pool& operator=(const Pool&) = delete;
+
+    ~Pool() {
+        for (std::size_t i = 0; i < _slabs.size() * SlabSize; ++i) {
+            Slot& slot = slot_at(i);
+            if (slot.alive)
+                slot.object()->~T();
+        }
+    }
+
+    void reserve(std::size_t capacity) {
+        while (_slabs.size() * SlabSize < capacity)
+            grow();
+    }
+
+    template <typename... Args>
+    Handle<T> emplace(Args&&... args) {
+        if (_free_head == npos)
+            grow();
+
+        std::uint32_t index = _free_head;
+        Slot& slot = slot_at(index);
+
+        ::new (slot.storage) T(std::forward<Args>(args)...);
+        _free_head = slot.next_free;
+        slot.alive = true;
+        ++_size;
+
+        return {index, slot.generation};
+    }
+
+    void erase(Handle<T> handle) {
+        if (!get(handle))
+            return;
+
+        Slot& slot = slot_at(handle.index);
+        slot.object()->~T();
+        slot.alive = false;
+        ++slot.generation;
+        slot.next_free = _free_head;
+        _free_head = handle.index;
+        --_size;
+    }
+
+    T* get(Handle<T> handle) {
+        if (handle.index >= _slabs.size() * SlabSize)
+            return nullptr;
+
+        Slot& slot = slot_at(handle.index);
+        return slot.alive && slot.generation == handle.generation ? slot.object() : nullptr;
+    }
+
+    std::size_t size() const { return _size; }
+
+private:
+    static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+    struct Slot {
+        T* object() { return std::launder(reinterpret_cast<T*>(storage)); }
+
+        alignas(T) std::byte storage[sizeof(T)];
+        std::uint32_t generation = 0;
+        std::uint32_t next_free = npos;
+        bool alive = false;
+    };
+
+    Slot& slot_at(std::uint32_t index) { return _slabs[index / SlabSize][index % SlabSize]; }
+
+    void grow() {
+        auto first = static_cast<std::uint32_t>(_slabs.size() * SlabSize);
+        _slabs.push_back(std::make_unique<Slot[]>(SlabSize));
+
+        // link new slots in order, so they are handed out from the beginning of the slab
+        for (std::uint32_t i = 0; i < SlabSize; ++i)
+            _slabs.back()[i].next_free = i + 1 < SlabSize ? first + i + 1 : _free_head;
+        _free_head = first;
+    }
+
+    std::vector<std::unique_ptr<Slot[]>> _slabs;
+    std::uint32_t _free_head = npos;
+    std::size_t _size = 0;
+};
+
+
+// Mediator owns all components. Routes point to the components by handles, so
+// a detached component is simply skipped instead of being accessed after free.
+class RegistryMediator : public Mediator {
+public:
+    template <typename T>
+    void reserve(std::size_t capacity) { pool<T>().reserve(capacity); }
+
+    template <typename T, typename... Args>
+    Handle<T> attach(Args&&... args) {
+        return pool<T>().emplace(this, std::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    void detach(Handle<T> handle) { pool<T>().erase(handle); }
+
+    template <typename T>
+    T* get(Handle<T> handle) { return pool<T>().get(handle); }
+
+    template <typename T>
+    std::size_t size() const { return std::get<Pool<T>>(_pools).size(); }
+
+    void route_a_to(Handle<ConcreteComponentA> handle) { _target_a = handle; }
+    void route_b_to(Handle<ConcreteComponentB> handle) { _target_b = handle; }
+
+    void notify(Component&, Events event) override {
+        if (event == Events::A) {
+            if (auto* component_a = get(_target_a))
+                component_a->do_logic();
+        }
+        else if (event == Events::B) {
+            if (auto* component_b = get(_target_b))
+                component_b->do_logic();
+        }
+    }
+
+private:
+    template <typename T>
+    Pool<T>& pool() { return std::get<Pool<T>>(_pools); }
+
+    std::tuple<Pool<ConcreteComponentA>, Pool<ConcreteComponentB>> _pools;
+    Handle<ConcreteComponentA> _target_a{};
+    Handle<ConcreteComponentB> _target_b{};
+};
+
+
+void client() {
+    RegistryMediator mediator;
+
+    auto handle_a = mediator.attach<ConcreteComponentA>();
+    auto handle_b = mediator.attach<ConcreteComponentB>();
+    mediator.route_a_to(handle_a);
+    mediator.route_b_to(handle_b);
+
+    mediator.get(handle_a)->do_b();
+    mediator.get(handle_b)->do_a();
+    std::cout << "B handled: " << mediator.get(handle_b)->handled() << '\n';    // B handled: 1
+
+    // Slot of B is reused by a new component, but the old handle is rejected
+    mediator.detach(handle_b);
+    auto new_handle_b = mediator.attach<ConcreteComponentB>();
+    std::cout << "Same slot: " << (new_handle_b.index == handle_b.index) << '\n';      // Same slot: 1
+    std::cout << "Old handle valid: " << (mediator.get(handle_b) != nullptr) << '\n';   // Old handle valid: 0
+
+    // Target of B is detached, so event is dropped
+    mediator.get(handle_a)->do_b();
+    std::cout << "New B handled: " << mediator.get(new_handle_b)->handled() << '\n';   // New B handled: 0
+}
+
+
+void benchmark() {
+    constexpr std::size_t components = 100'000;
+    constexpr int rounds = 50;
+
+    std::vector<Handle<ConcreteComponentA>> handles(components);
+    std::vector<std::unique_ptr<ConcreteComponentA>> owners(components);
+
+    RegistryMediator mediator;
+    mediator.reserve<ConcreteComponentA>(components);
+
+    std::size_t allocations_before = heap_usage::allocations();
+    auto begin = std::chrono::steady_clock::now();
+
+    for (int round = 0; round < rounds; ++round) {
+        for (auto& handle: handles)
+            handle = mediator.attach<ConcreteComponentA>();
+        for (auto& handle: handles)
+            mediator.detach(handle);
+    }
+
+    std::chrono::duration<double> pooled = std::chrono::steady_clock::now() - begin;
+    std::size_t pooled_allocations = heap_usage::allocations() - allocations_before;
+
+    allocations_before = heap_usage::allocations();
+    begin = std::chrono::steady_clock::now();
+
+    for (int round = 0; round < rounds; ++round) {
+        for (auto& owner: owners)
+            owner = std::make_unique<ConcreteComponentA>(&mediator);
+        for (auto& owner: owners)
+            owner.reset();
+    }
+
+    std::chrono::duration<double> heap = std::chrono::steady_clock::now() - begin;
+    std::size_t heap_allocations = heap_usage::allocations() - allocations_before;
+
+    double operations = 2.0 * components * rounds;
+    std::cout << "\nchurn of " << components << " components, " << rounds << " rounds" << '\n';
+    std::cout << "pool        |  attach+detach/s: " << static_cast<std::uint64_t>(operations / pooled.count())
+              << "  |  allocations: " << pooled_allocations << '\n';
+    std::cout << "make_unique |  attach+detach/s: " << static_cast<std::uint64_t>(operations / heap.count())
+              << "  |  allocations: " << heap_allocations << '\n';
+}
+
+
+int main() {
+    client();
+    benchmark();
+
+    return 0;
+}
@@ -0,0 +1,314 @@
+/*
+ * Mediator pattern: concurrent event bus
+ *
+ * Intent: same as in Mediator.cpp, components communicate only via mediator. Here the
+ * mediator is an event bus: components register handlers per event in a dense dispatch
+ * table, events can be posted from any thread and are delivered by worker threads.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+enum class Events { A, B, Count };
+
+constexpr std::size_t events_count = static_cast<std::size_t>(Events::Count);
+
+using ComponentId = std::uint32_t;
+
+
+// Bounded lock-free queue for many producers and one consumer (D. Vyukov's design).
+// Every cell stores a sequence number, so producers only compete for the tail index
+// and the consumer never touches shared counters.
+template <typename T>
+class MpscQueue {
+public:
+    explicit MpscQueue(std::size_t capacity)
+            : _capacity(std::bit_ceil(capacity)),
+              _mask(_capacity - 1),
+              _cells(std::make_unique<Cell[]>(_capacity)) {
+        for (std::size_t i = 0; i < _capacity; ++i)
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    bool try_push(const T& value) {
+        std::size_t position = _tail.load(std::memory_order_relaxed);
+
+        for (;;) {
+            Cell& cell = _cells[position & _mask];
+            std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+
+            if (diff == 0) {
+                if (_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false;   // queue is full
+            else
+                position = _tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    // Only one thread may pop
+    bool try_pop(T& value) {
+        Cell& cell = _cells[_head & _mask];
+        std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+
+        if (sequence != _head + 1)
+            return false;
+
+        value = cell.value;
+        cell.sequence.store(_head + _capacity, std::memory_order_release);
+        ++_head;
+        return true;
+    }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    const std::size_t _capacity;
+    const std::size_t _mask;
+    std::unique_ptr<Cell[]> _cells;
+
+    alignas(64) std::atomic<std::size_t> _tail{0};
+    alignas(64) std::size_t _head = 0;
+};
+
+
+// Event bus is the mediator. Handlers are registered per event before start(), after that
+// the dispatch table is immutable and is read by all threads without locks.
+// All events of one component are delivered by the same worker, so their order is preserved.
+class EventBus {
+public:
+    using Handler = std::function<void(ComponentId sender, Events event)>;
+
+    explicit EventBus(std::size_t workers = 1, std::size_t queue_capacity = 1 << 16) {
+        for (std::size_t i = 0; i < std::max<std::size_t>(workers, 1); ++i)
+            _queues.push_back(std::make_unique<MpscQueue<Envelope>>(queue_capacity));
+    }
+
+    ~EventBus() { stop(); }
+
+    EventBus(const EventBus&) = delete;
+    EventBus& operator=(const EventBus&) = delete;
+
+    void subscribe(ComponentId receiver, Events event, Handler handler) {
+        _routes[index(event)].push_back({receiver, std::move(handler)});
+    }
+
+    void start() {
+        for (std::size_t i = 0; i < _queues.size(); ++i)
+            _workers.emplace_back([this, i] { run_worker(i); });
+    }
+
+    // Delivers everything that was already posted and joins workers.
+    // Producers must be finished before stop() is called.
+    void stop() {
+        _stopping.store(true, std::memory_order_release);
+        for (auto& worker: _workers)
+            worker.join();
+        _workers.clear();
+        _stopping.store(false, std::memory_order_relaxed);
+    }
+
+    // Thread safe. Fans the event out to every subscriber.
+    void post(ComponentId sender, Events event) {
+        const auto& routes = _routes[index(event)];
+
+        for (std::uint32_t route = 0; route < routes.size(); ++route) {
+            Envelope envelope{sender, route, event};
+            auto& queue = *_queues[routes[route].receiver % _queues.size()];
+
+            while (!queue.try_push(envelope))
+                std::this_thread::yield();
+        }
+    }
+
+    std::size_t workers() const { return _queues.size(); }
+
+private:
+    struct Envelope {
+        ComponentId sender;
+        std::uint32_t route;
+        Events event;
+    };
+
+    struct Route {
+        ComponentId receiver;
+        Handler handler;
+    };
+
+    static std::size_t index(Events event) { return static_cast<std::size_t>(event); }
+
+    void dispatch(const Envelope& envelope) const {
+        _routes[index(envelope.event)][envelope.route].handler(envelope.sender, envelope.event);
+    }
+
+    void run_worker(std::size_t worker) {
+        auto& queue = *_queues[worker];
+        Envelope envelope{};
+
+        while (!_stopping.load(std::memory_order_acquire)) {
+            if (queue.try_pop(envelope))
+                dispatch(envelope);
+            else
+                std::this_thread::yield();
+        }
+
+        while (queue.try_pop(envelope))
+            dispatch(envelope);
+    }
+
+    std::array<std::vector<Route>, events_count> _routes{};
+    std::vector<std::unique_ptr<MpscQueue<Envelope>>> _queues;
+    std::vector<std::thread> _workers;
+    std::atomic<bool> _stopping{false};
+};
+
+
+// Components know only the bus and their own id
+class Component {
+public:
+    Component(EventBus& bus, ComponentId id) : _bus(bus), _id(id) {}
+
+    ComponentId id() const { return _id; }
+
+protected:
+    void notify(Events event) const { _bus.post(_id, event); }
+
+    EventBus& _bus;
+    ComponentId _id;
+};
+
+
+// Handlers of one component always run on one worker, so plain counters are enough
+class ConcreteComponentA : public Component {
+public:
+    using Component::Component;
+
+    void do_logic() { ++_handled; }
+    void do_b() const { notify(Events::B); }
+
+    std::uint64_t handled() const { return _handled; }
+
+private:
+    std::uint64_t _handled = 0;
+};
+
+
+class ConcreteComponentB : public Component {
+public:
+    using Component::Component;
+
+    void do_logic() { ++_handled; }
+    void do_a() const { notify(Events::A); }
+
+    std::uint64_t handled() const { return _handled; }
+
+private:
+    std::uint64_t _handled = 0;
+};
+
+
+// Same routing as ConcreteMediator: A triggers component A, B triggers component B
+void wire(EventBus& bus, ConcreteComponentA& component_a, ConcreteComponentB& component_b) {
+    bus.subscribe(component_a.id(), Events::A, [&component_a](ComponentId, Events) { component_a.do_logic(); });
+    bus.subscribe(component_b.id(), Events::B, [&component_b](ComponentId, Events) { component_b.do_logic(); });
+}
+
+
+void client() {
+    EventBus bus{2};
+
+    ConcreteComponentA component_a{bus, 0};
+    ConcreteComponentB component_b{bus, 1};
+    wire(bus, component_a, component_b);
+
+    bus.start();
+
+    std::thread producer([&] {
+        for (int i = 0; i < 1000; ++i)
+            component_a.do_b();
+    });
+    for (int i = 0; i < 500; ++i)
+        component_b.do_a();
+
+    producer.join();
+    bus.stop();
+
+    std::cout << "A handled: " << component_a.handled() << '\n';   // A handled: 500
+    std::cout << "B handled: " << component_b.handled() << '\n';   // B handled: 1000
+}
+
+
+void benchmark() {
+    constexpr std::size_t events_total = 500'000;
+    constexpr std::size_t pairs = 32;
+    constexpr std::size_t workers = 2;
+
+    std::cout << "\nevent bus, " << workers << " workers, " << pairs * 2 << " components" << '\n';
+
+    for (std::size_t producers: {1, 2, 4, 8}) {
+        EventBus bus{workers};
+
+        std::vector<std::unique_ptr<ConcreteComponentA>> components_a;
+        std::vector<std::unique_ptr<ConcreteComponentB>> components_b;
+        for (ComponentId i = 0; i < pairs; ++i) {
+            components_a.push_back(std::make_unique<ConcreteComponentA>(bus, 2 * i));
+            components_b.push_back(std::make_unique<ConcreteComponentB>(bus, 2 * i + 1));
+            wire(bus, *components_a.back(), *components_b.back());
+        }
+
+        bus.start();
+        auto begin = std::chrono::steady_clock::now();
+
+        std::vector<std::thread> threads;
+        for (std::size_t p = 0; p < producers; ++p) {
+            threads.emplace_back([&, p] {
+                for (std::size_t i = p; i < events_total; i += producers) {
+                    if (i & 1)
+                        components_a[i % pairs]->do_b();
+                    else
+                        components_b[i % pairs]->do_a();
+                }
+            });
+        }
+        for (auto& thread: threads)
+            thread.join();
+        bus.stop();
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+        // every event has `pairs` subscribers
+        std::uint64_t delivered = 0;
+        for (std::size_t i = 0; i < pairs; ++i)
+            delivered += components_a[i]->handled() + components_b[i]->handled();
+
+        std::cout << "producers: " << producers
+                  << "  |  posted/s: " << static_cast<std::uint64_t>(events_total / elapsed.count())
+                  << "  |  delivered/s: " << static_cast<std::uint64_t>(delivered / elapsed.count()) << '\n';
+    }
+}
+
+
+int main() {
+    client();
+    benchmark();
+
+    return 0;
+}
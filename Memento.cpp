@@ -25,7 +25,7 @@ protected:
 };
 
 
-class Orignator;
+class Originator;
 
 
 class MementoOriginator : public Memento {
@@ -34,7 +34,7 @@ public:
     explicit MementoOriginator(const State& state) : _state(state) {}
     explicit MementoOriginator(State&& state) : _state(std::move(state)) {}
 
-    friend class Orignator;
+    friend class Originator;
 
 private:
     void set_state(State& state) override {
@@ -65,7 +65,7 @@ public:
     }
 
     void set_memento(MementoOriginator* memento) {
-        _state = memento.;
+        _state = memento->get_state();
     }
 };
 
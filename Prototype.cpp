@@ -2,10 +2,20 @@
 // Created by vladislav on 07.07.22.
 //
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
 #include <string>
+#include <typeinfo>
 #include <unordered_map>
-#include <memory>
+#include <vector>
+
+#include "HeapUsage.h"
 
 class Prototype {
 public:
@@ -16,12 +26,216 @@ public:
 
     virtual std::unique_ptr<Prototype> clone() const = 0;
 
+    const std::string& get_prototype_name() const { return _prototype_name; }
+
 protected:
     std::string _prototype_name;
 };
 
-int main() {
 
+// Free list of equally sized blocks. Memory of destroyed objects is reused by next ones,
+// new slabs are taken from the heap only when the list is empty.
+template <std::size_t BlockSize, std::size_t SlabSize = 256>
+class BlockPool {
+public:
+    void* allocate() {
+        std::lock_guard lock(_mutex);
+
+        if (_free == nullptr) {
+            auto& slab = _slabs.emplace_back(std::make_unique<Block[]>(SlabSize));
+            for (std::size_t i = 0; i < SlabSize; ++i)
+                slab[i].next = i + 1 < SlabSize ? &slab[i + 1] : nullptr;
+            _free = &slab[0];
+        }
+
+        Block* block = _free;
+        _free = block->next;
+        return block;
+    }
+
+    void deallocate(void* pointer) {
+        std::lock_guard lock(_mutex);
+
+        auto* block = static_cast<Block*>(pointer);
+        block->next = _free;
+        _free = block;
+    }
+
+private:
+    union Block {
+        Block* next;
+        alignas(std::max_align_t) std::byte storage[BlockSize];
+    };
+
+    std::mutex _mutex;
+    Block* _free = nullptr;
+    std::vector<std::unique_ptr<Block[]>> _slabs;
+};
+
+
+// Heavy part of a monster, shared by all clones until one of them changes it
+struct Texture {
+    std::vector<std::uint32_t> pixels;
+};
+
+
+class Monster : public Prototype {
+public:
+    Monster(std::string name, std::size_t texture_size, int health)
+        : Prototype(std::move(name)),
+          _texture(std::make_shared<Texture>(Texture{std::vector<std::uint32_t>(texture_size, 0xFFFFFFFF)})),
+          _health(health) {}
+
+    // Clone shares the texture, so it costs O(1) whatever the texture size is
+    std::unique_ptr<Prototype> clone() const override {
+        return std::unique_ptr<Monster>(new Monster(*this));
+    }
+
+    // Copies the texture too, used as baseline
+    std::unique_ptr<Monster> deep_clone() const {
+        auto monster = std::unique_ptr<Monster>(new Monster(*this));
+        monster->_texture = std::make_shared<Texture>(*_texture);
+        return monster;
+    }
+
+    // Changing the texture makes own copy first (copy on write)
+    void paint(std::uint32_t color) {
+        if (_texture.use_count() > 1)
+            _texture = std::make_shared<Texture>(*_texture);
+
+        for (auto& pixel: _texture->pixels)
+            pixel = color;
+    }
+
+    void set_health(int health) { _health = health; }
+    int get_health() const { return _health; }
+
+    bool shares_texture_with(const Monster& other) const { return _texture == other._texture; }
+
+    // Monsters are allocated from the pool, clone() keeps returning plain unique_ptr
+    static auto& pool() {
+        static BlockPool<sizeof(Monster)> instance;
+        return instance;
+    }
+
+    static void* operator new(std::size_t size) {
+        if (size != sizeof(Monster))
+            return ::operator new(size);
+        return pool().allocate();
+    }
+
+    static void operator delete(void* pointer, std::size_t size) {
+        if (size != sizeof(Monster))
+            return ::operator delete(pointer);
+        pool().deallocate(pointer);
+    }
+
+private:
+    Monster(const Monster&) = default;
+
+    std::shared_ptr<Texture> _texture;
+    int _health;
+};
+
+
+// Keeps prototypes by their names and spawns clones of them
+class PrototypeRegistry {
+public:
+    void add(std::unique_ptr<Prototype> prototype) {
+        std::string name = prototype->get_prototype_name();
+        _prototypes[std::move(name)] = std::move(prototype);
+    }
+
+    std::unique_ptr<Prototype> spawn(const std::string& name) const {
+        auto found = _prototypes.find(name);
+        if (found == _prototypes.end())
+            throw std::out_of_range("Unknown prototype: " + name);
+
+        return found->second->clone();
+    }
+
+    // Spawns a clone of known type
+    template <typename T>
+    std::unique_ptr<T> spawn_as(const std::string& name) const {
+        std::unique_ptr<Prototype> clone = spawn(name);
+        auto* concrete = dynamic_cast<T*>(clone.get());
+        if (concrete == nullptr)
+            throw std::bad_cast();
+
+        clone.release();
+        return std::unique_ptr<T>(concrete);
+    }
+
+private:
+    std::unordered_map<std::string, std::unique_ptr<Prototype>> _prototypes;
+};
+
+
+void client() {
+    PrototypeRegistry registry;
+    registry.add(std::make_unique<Monster>("Orc", 1 << 16, 100));
+    registry.add(std::make_unique<Monster>("Goblin", 1 << 12, 30));
+
+    auto orc_1 = registry.spawn_as<Monster>("Orc");
+    auto orc_2 = registry.spawn_as<Monster>("Orc");
+    orc_2->set_health(50);
+
+    std::cout << orc_1->get_prototype_name() << ' ' << orc_1->get_health() << '\n';   // Orc 100
+    std::cout << orc_2->get_prototype_name() << ' ' << orc_2->get_health() << '\n';   // Orc 50
+    std::cout << "Texture shared: " << orc_1->shares_texture_with(*orc_2) << '\n';     // Texture shared: 1
+
+    orc_2->paint(0xFF0000FF);
+    std::cout << "Texture shared: " << orc_1->shares_texture_with(*orc_2) << '\n';     // Texture shared: 0
+}
+
+
+void benchmark() {
+    constexpr std::size_t texture_size = 1 << 18;   // 1 MB of pixels
+    constexpr std::size_t clones_count = 10'000;
+
+    Monster prototype{"Dragon", texture_size, 1000};
+
+    std::vector<std::unique_ptr<Prototype>> clones;
+    clones.reserve(clones_count);
+
+    std::size_t before = heap_usage::allocated_bytes();
+    auto begin = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < clones_count; ++i)
+        clones.push_back(prototype.clone());
+    std::chrono::duration<double> cow_time = std::chrono::steady_clock::now() - begin;
+    std::size_t cow_bytes = heap_usage::allocated_bytes() - before;
+
+    // Memory of the first clones is reused by the next ones
+    clones.clear();
+    before = heap_usage::allocated_bytes();
+    begin = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < clones_count; ++i)
+        clones.push_back(prototype.clone());
+    std::chrono::duration<double> pooled_time = std::chrono::steady_clock::now() - begin;
+    std::size_t pooled_bytes = heap_usage::allocated_bytes() - before;
+    clones.clear();
+
+    // 10 GB of deep copies don't fit into memory, so every copy is dropped at once
+    before = heap_usage::allocated_bytes();
+    begin = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < clones_count; ++i)
+        prototype.deep_clone()->set_health(static_cast<int>(i));
+    std::chrono::duration<double> deep_time = std::chrono::steady_clock::now() - begin;
+    std::size_t deep_bytes = heap_usage::allocated_bytes() - before;
+
+    std::cout << "\n" << clones_count << " clones of a prototype with 1 MB texture" << '\n';
+    std::cout << "copy on write          |  clones/s: " << static_cast<std::uint64_t>(clones_count / cow_time.count())
+              << "  |  bytes/clone: " << cow_bytes / clones_count << '\n';
+    std::cout << "copy on write, reused  |  clones/s: " << static_cast<std::uint64_t>(clones_count / pooled_time.count())
+              << "  |  bytes/clone: " << pooled_bytes / clones_count << '\n';
+    std::cout << "deep copy              |  clones/s: " << static_cast<std::uint64_t>(clones_count / deep_time.count())
+              << "  |  bytes/clone: " << deep_bytes / clones_count << '\n';
+}
+
+
+int main() {
+    client();
+    benchmark();
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,357 @@
+//
+// PrototypeFactory that clones one object n times into contiguous storage
+//
+// clone() makes one heap allocation per copy. clone_n() allocates storage for all copies
+// at once and fills it. Trivially copyable objects are broadcast with memcpy, others are
+// copy constructed in place. Large batches are split between threads of a pool.
+// The path is chosen at compile time from the type of the object.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Instrumentation.h"
+
+
+template <typename T>
+concept Clonable = std::is_copy_constructible_v<T>;
+
+// Copies of such objects are just their bytes
+template <typename T>
+concept TriviallyClonable = Clonable<T> && std::is_trivially_copyable_v<T>;
+
+
+// Threads that wait for jobs. The thread calling run() works on the job too.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threads) {
+        for (unsigned i = 1; i < threads; ++i)
+            _workers.emplace_back([this] { work(); });
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard lock(_mutex);
+            _stop = true;
+        }
+        _wake.notify_all();
+
+        for (auto& worker: _workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(_workers.size()) + 1; }
+
+    // Calls task(i) for every i in [0, count) and waits for all of them.
+    // Rethrows the first exception thrown by a task.
+    void run(std::size_t count, std::function<void(std::size_t)> task) {
+        auto job = std::make_shared<Job>(std::move(task), count);
+        {
+            std::lock_guard lock(_mutex);
+            _job = job;
+            ++_generation;
+        }
+        _wake.notify_all();
+
+        execute(*job);
+
+        std::unique_lock lock(_mutex);
+        _done.wait(lock, [&] { return job->pending == 0; });
+        _job.reset();
+
+        if (job->error)
+            std::rethrow_exception(job->error);
+    }
+
+private:
+    struct Job {
+        Job(std::function<void(std::size_t)> task, std::size_t count)
+            : task(std::move(task)), count(count), pending(count) {}
+
+        std::function<void(std::size_t)> task;
+        std::size_t count;
+        std::atomic<std::size_t> next{0};
+        std::atomic<std::size_t> pending;
+        std::exception_ptr error;   // guarded by the pool mutex
+    };
+
+    void work() {
+        std::uint64_t seen = 0;
+        for (;;) {
+            std::shared_ptr<Job> job;
+            {
+                std::unique_lock lock(_mutex);
+                _wake.wait(lock, [&] { return _stop || _generation != seen; });
+                if (_stop)
+                    return;
+                seen = _generation;
+                job = _job;
+            }
+            if (job)
+                execute(*job);
+        }
+    }
+
+    void execute(Job& job) {
+        for (;;) {
+            std::size_t i = job.next.fetch_add(1, std::memory_order_relaxed);
+            if (i >= job.count)
+                return;
+
+            try {
+                job.task(i);
+            }
+            catch (...) {
+                std::lock_guard lock(_mutex);
+                if (!job.error)
+                    job.error = std::current_exception();
+            }
+
+            if (job.pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard lock(_mutex);
+                _done.notify_all();
+            }
+        }
+    }
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    std::shared_ptr<Job> _job;
+    std::uint64_t _generation = 0;
+    bool _stop = false;
+    std::vector<std::thread> _workers;
+};
+
+
+// Contiguous storage of clones, objects are constructed in place and never move
+template <typename T>
+class Clones {
+public:
+    Clones() = default;
+
+    Clones(Clones&& other) noexcept
+        : _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0)) {}
+
+    Clones& operator=(Clones&& other) noexcept {
+        std::swap(_data, other._data);
+        std::swap(_size, other._size);
+        return *this;
+    }
+
+    ~Clones() {
+        if (_data == nullptr)
+            return;
+        std::destroy_n(_data, _size);
+        std::allocator<T>{}.deallocate(_data, _size);
+    }
+
+    T* begin() const { return _data; }
+    T* end() const { return _data + _size; }
+    std::size_t size() const { return _size; }
+    T& operator[](std::size_t i) const { return _data[i]; }
+    std::span<T> span() const { return {_data, _size}; }
+
+private:
+    friend class PrototypeFactory;
+
+    T* _data = nullptr;
+    std::size_t _size = 0;
+};
+
+
+class PrototypeFactory {
+public:
+    // Batches smaller than this are filled by the calling thread only
+    static constexpr std::size_t parallel_bytes = 1 << 20;
+
+    explicit PrototypeFactory(unsigned threads = std::thread::hardware_concurrency())
+        : _pool(std::max(threads, 1u)) {}
+
+    template <Clonable T>
+    decltype(auto) clone(const T& object) {
+        return std::make_unique<T>(object);
+    }
+
+    template <Clonable T>
+    Clones<T> clone_n(const T& object, std::size_t n) {
+        if (n == 0)
+            return {};
+
+        T* data = std::allocator<T>{}.allocate(n);
+
+        std::size_t chunks = n * sizeof(T) < parallel_bytes ? 1 : _pool.size();
+        std::size_t chunk = (n + chunks - 1) / chunks;
+        chunks = (n + chunk - 1) / chunk;
+
+        std::vector<char> filled(chunks, false);
+        try {
+            auto fill_chunk = [&](std::size_t i) {
+                std::size_t begin = i * chunk;
+                fill(object, data + begin, std::min(chunk, n - begin));
+                filled[i] = true;
+            };
+
+            if (chunks == 1)
+                fill_chunk(0);
+            else
+                _pool.run(chunks, fill_chunk);
+        }
+        catch (...) {
+            // fill() cleans up its own chunk, the chunks which were filled are destroyed here
+            for (std::size_t i = 0; i < chunks; ++i) {
+                if (filled[i])
+                    std::destroy_n(data + i * chunk, std::min(chunk, n - i * chunk));
+            }
+            std::allocator<T>{}.deallocate(data, n);
+            throw;
+        }
+
+        Clones<T> clones;
+        clones._data = data;
+        clones._size = n;
+        return clones;
+    }
+
+private:
+    template <Clonable T>
+    static void fill(const T& object, T* first, std::size_t count) {
+        std::uninitialized_fill_n(first, count, object);
+    }
+
+    // Doubles the filled prefix with memcpy until it reaches a cache sized block,
+    // then repeats that block to the end
+    template <TriviallyClonable T>
+    static void fill(const T& object, T* first, std::size_t count) {
+        constexpr std::size_t block_bytes = 16 << 10;
+
+        std::memcpy(first, &object, sizeof(T));
+        std::size_t filled = 1;
+
+        while (filled < count && filled * sizeof(T) < block_bytes) {
+            std::size_t copied = std::min(filled, count - filled);
+            std::memcpy(first + filled, first, copied * sizeof(T));
+            filled += copied;
+        }
+
+        std::size_t block = filled;
+        while (filled < count) {
+            std::size_t copied = std::min(block, count - filled);
+            std::memcpy(first + filled, first, copied * sizeof(T));
+            filled += copied;
+        }
+    }
+
+    ThreadPool _pool;
+};
+
+
+// Copies are counted by instrumentation, clone_n copies from several threads
+struct Checker : instrumentation::Counted {};
+
+
+struct Particle {
+    float position[3];
+    float velocity[3];
+    std::uint32_t color;
+};
+
+
+struct Soldier {
+    std::string name = "Soldier of the Northern Legion";   // doesn't fit into small string buffer
+    int health = 100;
+};
+
+
+// Keeps compiler from dropping clones which are never read
+template <typename T>
+void do_not_optimize(const T& value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+
+void client() {
+    instrumentation::Scope scope;
+    Checker checker{};
+
+    PrototypeFactory factory;
+    auto new_checker = factory.clone<Checker>(checker);
+    std::cout << scope.counters().copies << '\n';   // 1
+
+    auto checkers = factory.clone_n(checker, 2'000'000);
+    std::cout << scope.counters().copies << '\n';   // 2000001
+
+    Particle spark{{1, 2, 3}, {0, 0, -1}, 0xFFAA00};
+    auto sparks = factory.clone_n(spark, 1'000'000);
+    bool same = std::all_of(sparks.begin(), sparks.end(), [&](const Particle& particle) {
+        return std::memcmp(&particle, &spark, sizeof(Particle)) == 0;
+    });
+    std::cout << "Particles: " << sparks.size() << ", all equal: " << same << '\n';   // Particles: 1000000, all equal: 1
+
+    auto soldiers = factory.clone_n(Soldier{}, 3);
+    std::cout << soldiers[2].name << '\n';   // Soldier of the Northern Legion
+}
+
+
+template <typename T>
+void benchmark_type(const char* name, const T& object, std::size_t n) {
+    auto report = [&](const char* method, auto clone) {
+        auto begin = std::chrono::steady_clock::now();
+        auto clones = clone();
+        do_not_optimize(clones);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+        std::cout << name << ", " << method << "  |  clones/s: " << static_cast<std::uint64_t>(n / elapsed.count()) << '\n';
+    };
+
+    PrototypeFactory factory;
+
+    report("clone() in a loop     ", [&] {
+        std::vector<std::unique_ptr<T>> clones;
+        clones.reserve(n);
+        for (std::size_t i = 0; i < n; ++i)
+            clones.push_back(factory.clone(object));
+        return clones;
+    });
+
+    report("vector(n, object)     ", [&] { return std::vector<T>(n, object); });
+
+    for (unsigned threads: {1u, 2u, 4u}) {
+        PrototypeFactory parallel{threads};
+        std::string method = "clone_n, " + std::to_string(threads) + " threads    ";
+        report(method.c_str(), [&] { return parallel.clone_n(object, n); });
+    }
+}
+
+
+void benchmark() {
+    std::cout << '\n';
+    benchmark_type("Particle (trivial)    ", Particle{{1, 2, 3}, {0, 0, -1}, 0xFFAA00}, 10'000'000);
+    benchmark_type("Soldier (non-trivial) ", Soldier{}, 2'000'000);
+}
+
+
+int main() {
+    client();
+    benchmark();
+
+    return 0;
+}
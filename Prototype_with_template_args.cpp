@@ -4,6 +4,10 @@
 
 #include <memory>
 #include <iostream>
+#include <string>
+#include <vector>
+
+#include "Instrumentation.h"
 
 
 class PrototypeFactory {
@@ -16,27 +20,33 @@ public:
 };
 
 
-struct Checker {
-    static inline int count = 1;
-
-    Checker() = default;
-    Checker(const Checker& checker) { count++; }
-
-    friend std::ostream& operator<< (std::ostream& output, Checker& checker) {
-        output << count << '\n';
-        return output;
-    }
-};
+// Copies are counted by instrumentation, not by a static counter
+struct Checker : instrumentation::Counted {};
 
 
 int main() {
+    instrumentation::Scope scope;
     Checker checker{};
 
     PrototypeFactory factory;
-    std::cout << checker;       // 1
+    std::cout << scope.counters().copies << '\n';   // 0
 
     auto new_checker = factory.clone<Checker>(checker);
-    std::cout << *new_checker;  // 2
+    std::cout << scope.counters().copies << '\n';   // 1
+
+    // Auditing a hot path: cloning names into a vector. Every clone allocates its node,
+    // counted by Tracked, and a copy of the long string, counted by its allocator.
+    using CountedString = std::basic_string<char, std::char_traits<char>, instrumentation::CountingAllocator<char>>;
+    using Name = instrumentation::Tracked<CountedString>;
+    Name name{"Prototype with a name too long for small string buffer"};
+    std::vector<std::unique_ptr<Name>, instrumentation::CountingAllocator<std::unique_ptr<Name>>> names;
+
+    scope.restart();
+    for (int i = 0; i < 1000; ++i)
+        names.push_back(factory.clone(name));
+    scope.report(std::cout, "clone into vector", 1000);
+
+    // clone into vector  |  copies/op: 1  |  moves/op: 0  |  allocations/op: 2.011  |  bytes/op: 103.376
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,561 @@
+/*
+ * Proxy pattern: protection proxy with a verification engine
+ *
+ * Intent: same as in Proxy.cpp, the proxy checks access before it passes calls to the account.
+ * AccountProxy there compares plain passwords with operator==, which returns at the first
+ * different char, and reads std::cin on every call. Here passwords are kept as salted
+ * PBKDF2-HMAC-SHA256 hashes and compared in constant time, batches of credentials are
+ * verified by several threads, and a successful login gives a session token, so later
+ * calls don't verify the password again.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <sys/random.h>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+// SHA-256 (FIPS 180-4)
+class Sha256 {
+public:
+    using Digest = std::array<std::uint8_t, 32>;
+    static constexpr std::size_t block_size = 64;
+
+    void update(const void* data, std::size_t size) {
+        auto bytes = static_cast<const std::uint8_t*>(data);
+        _length += size;
+
+        if (_buffered != 0) {
+            std::size_t taken = std::min(size, block_size - _buffered);
+            std::memcpy(_buffer.data() + _buffered, bytes, taken);
+            _buffered += taken;
+            bytes += taken;
+            size -= taken;
+            if (_buffered < block_size)
+                return;
+            compress(_buffer.data());
+            _buffered = 0;
+        }
+
+        for (; size >= block_size; bytes += block_size, size -= block_size)
+            compress(bytes);
+
+        std::memcpy(_buffer.data(), bytes, size);
+        _buffered = size;
+    }
+
+    void update(std::string_view text) { update(text.data(), text.size()); }
+
+    Digest finish() {
+        std::uint64_t bits = _length * 8;
+        std::uint8_t padding[block_size + 8] = {0x80};
+        std::size_t padding_size = (_buffered < 56 ? 56 : 120) - _buffered;
+        for (int i = 0; i < 8; ++i)
+            padding[padding_size + i] = static_cast<std::uint8_t>(bits >> (56 - 8 * i));
+        update(padding, padding_size + 8);
+
+        Digest digest;
+        for (int i = 0; i < 8; ++i) {
+            for (int j = 0; j < 4; ++j)
+                digest[4 * i + j] = static_cast<std::uint8_t>(_state[i] >> (24 - 8 * j));
+        }
+        return digest;
+    }
+
+private:
+    void compress(const std::uint8_t* block) {
+        static constexpr std::uint32_t k[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+        std::uint32_t w[64];
+        for (int i = 0; i < 16; ++i)
+            w[i] = std::uint32_t(block[4 * i]) << 24 | std::uint32_t(block[4 * i + 1]) << 16 |
+                   std::uint32_t(block[4 * i + 2]) << 8 | std::uint32_t(block[4 * i + 3]);
+        for (int i = 16; i < 64; ++i) {
+            std::uint32_t s0 = std::rotr(w[i - 15], 7) ^ std::rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            std::uint32_t s1 = std::rotr(w[i - 2], 17) ^ std::rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        auto [a, b, c, d, e, f, g, h] = _state;
+        for (int i = 0; i < 64; ++i) {
+            std::uint32_t t1 = h + (std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+            std::uint32_t t2 = (std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+
+        _state[0] += a; _state[1] += b; _state[2] += c; _state[3] += d;
+        _state[4] += e; _state[5] += f; _state[6] += g; _state[7] += h;
+    }
+
+    std::array<std::uint32_t, 8> _state = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                           0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    std::array<std::uint8_t, block_size> _buffer{};
+    std::size_t _buffered = 0;
+    std::uint64_t _length = 0;
+};
+
+
+// HMAC-SHA256 with the key pads hashed once, so every PBKDF2 round costs two compressions less
+class HmacSha256 {
+public:
+    explicit HmacSha256(std::string_view key) {
+        std::array<std::uint8_t, Sha256::block_size> block{};
+        if (key.size() > block.size()) {
+            Sha256 hash;
+            hash.update(key);
+            auto digest = hash.finish();
+            std::memcpy(block.data(), digest.data(), digest.size());
+        }
+        else
+            std::memcpy(block.data(), key.data(), key.size());
+
+        std::array<std::uint8_t, Sha256::block_size> pad;
+        for (std::size_t i = 0; i < pad.size(); ++i)
+            pad[i] = block[i] ^ 0x36;
+        _inner.update(pad.data(), pad.size());
+        for (std::size_t i = 0; i < pad.size(); ++i)
+            pad[i] = block[i] ^ 0x5c;
+        _outer.update(pad.data(), pad.size());
+    }
+
+    Sha256::Digest operator()(const void* message, std::size_t size) const {
+        Sha256 inner = _inner;
+        inner.update(message, size);
+        auto digest = inner.finish();
+
+        Sha256 outer = _outer;
+        outer.update(digest.data(), digest.size());
+        return outer.finish();
+    }
+
+private:
+    Sha256 _inner;
+    Sha256 _outer;
+};
+
+
+using Salt = std::array<std::uint8_t, 16>;
+using PasswordHash = Sha256::Digest;
+
+// PBKDF2-HMAC-SHA256 (RFC 8018) with one output block
+PasswordHash pbkdf2(std::string_view password, std::span<const std::uint8_t> salt, unsigned iterations) {
+    HmacSha256 hmac{password};
+
+    std::uint8_t first[64 + 4] = {};
+    std::size_t salt_size = std::min(salt.size(), std::size_t{64});
+    std::memcpy(first, salt.data(), salt_size);
+    first[salt_size + 3] = 1;   // block index, big endian
+
+    PasswordHash u = hmac(first, salt_size + 4);
+    PasswordHash result = u;
+    for (unsigned i = 1; i < iterations; ++i) {
+        u = hmac(u.data(), u.size());
+        for (std::size_t j = 0; j < result.size(); ++j)
+            result[j] ^= u[j];
+    }
+    return result;
+}
+
+
+// Time depends only on the size, not on where the first difference is
+template <std::size_t Size>
+bool constant_time_equal(const std::array<std::uint8_t, Size>& left, const std::array<std::uint8_t, Size>& right) {
+    std::uint8_t difference = 0;
+    for (std::size_t i = 0; i < Size; ++i)
+        difference |= left[i] ^ right[i];
+
+    // Keeps the compiler from turning the loop into an early-exit comparison
+    asm volatile("" : "+r"(difference));
+    return difference == 0;
+}
+
+
+struct Credentials {
+    std::string login;
+    std::string password;
+};
+
+using SessionToken = std::array<std::uint8_t, 16>;
+
+struct DigestHash {
+    std::size_t operator()(const Sha256::Digest& digest) const {
+        std::size_t hash;
+        std::memcpy(&hash, digest.data(), sizeof(hash));   // digests are uniform already
+        return hash;
+    }
+};
+
+
+// Session expires `ttl` after it was opened. When there are `max_sessions` of them,
+// opening one more closes the oldest.
+struct SessionLimits {
+    std::chrono::steady_clock::duration ttl = std::chrono::minutes(15);
+    std::size_t max_sessions = 100'000;
+};
+
+class VerificationEngine {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit VerificationEngine(unsigned iterations = 1000, unsigned threads = std::thread::hardware_concurrency(),
+                                SessionLimits limits = {})
+        : _iterations(iterations), _threads(std::max(threads, 1u)), _limits(limits) {
+        // Unknown logins are checked against this record, so they take as long as known ones
+        _dummy.salt = random_bytes<Salt>();
+        _dummy.hash = pbkdf2("", _dummy.salt, _iterations);
+    }
+
+    void add_user(const std::string& login, std::string_view password) {
+        Record record;
+        record.salt = random_bytes<Salt>();
+        record.hash = pbkdf2(password, record.salt, _iterations);
+
+        std::unique_lock lock(_mutex);
+        _records[login] = record;
+    }
+
+    bool verify(const Credentials& credentials) const {
+        Record record = _dummy;
+        bool known = false;
+        {
+            std::shared_lock lock(_mutex);
+            auto found = _records.find(credentials.login);
+            if (found != _records.end()) {
+                record = found->second;
+                known = true;
+            }
+        }
+
+        bool equal = constant_time_equal(pbkdf2(credentials.password, record.salt, _iterations), record.hash);
+        return equal & known;
+    }
+
+    // results[i] tells whether credentials[i] are right. Every batch starts its own threads,
+    // which takes microseconds next to milliseconds of PBKDF2 in every chunk.
+    void verify_batch(std::span<const Credentials> credentials, std::span<bool> results) const {
+        constexpr std::size_t chunk = 8;
+        std::size_t chunks = (credentials.size() + chunk - 1) / chunk;
+
+        std::atomic<std::size_t> next{0};
+        std::mutex error_mutex;
+        std::exception_ptr error;
+
+        auto work = [&] {
+            for (std::size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < chunks;) {
+                try {
+                    std::size_t end = std::min(credentials.size(), (i + 1) * chunk);
+                    for (std::size_t j = i * chunk; j < end; ++j)
+                        results[j] = verify(credentials[j]);
+                }
+                catch (...) {
+                    std::lock_guard lock(error_mutex);
+                    if (!error)
+                        error = std::current_exception();
+                }
+            }
+        };
+
+        {
+            std::vector<std::jthread> workers;
+            for (std::size_t i = 1; i < std::min<std::size_t>(_threads, chunks); ++i)
+                workers.emplace_back(work);
+            work();
+        }
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    // Verifies the password once, later calls only show the token
+    std::optional<SessionToken> open_session(const Credentials& credentials) {
+        if (!verify(credentials))
+            return std::nullopt;
+
+        SessionToken token = random_bytes<SessionToken>();
+        Sha256::Digest key = session_key(token);
+        Clock::time_point expires = Clock::now() + _limits.ttl;
+
+        std::unique_lock lock(_mutex);
+        evict_sessions(Clock::now());
+        _sessions[key] = Session{credentials.login, expires};
+        _expiry.emplace_back(expires, key);
+        return token;
+    }
+
+    // True if the session is open, not expired and belongs to `login`.
+    // Sessions are found by SHA-256 of the token. The lookup itself is not constant time,
+    // but its timing can only tell something about the digest, not about the token.
+    bool check_session(const SessionToken& token, std::string_view login) const {
+        Sha256::Digest key = session_key(token);
+        Clock::time_point now = Clock::now();
+
+        std::shared_lock lock(_mutex);
+        auto found = _sessions.find(key);
+        return found != _sessions.end() && now < found->second.expires && found->second.login == login;
+    }
+
+    void close_session(const SessionToken& token) {
+        Sha256::Digest key = session_key(token);
+        std::unique_lock lock(_mutex);
+        _sessions.erase(key);
+    }
+
+private:
+    struct Record {
+        Salt salt;
+        PasswordHash hash;
+    };
+
+    struct Session {
+        std::string login;
+        Clock::time_point expires;
+    };
+
+    // Called with the mutex locked. Sessions expire in the order they were opened, so
+    // expired ones and, above the limit, the oldest ones are at the front of _expiry.
+    // Entries of closed sessions stay there until their expiry time and are skipped.
+    void evict_sessions(Clock::time_point now) {
+        while (!_expiry.empty() && (_expiry.front().first <= now || _sessions.size() >= _limits.max_sessions)) {
+            auto [expires, key] = _expiry.front();
+            _expiry.pop_front();
+
+            auto found = _sessions.find(key);
+            if (found != _sessions.end() && found->second.expires == expires)
+                _sessions.erase(found);
+        }
+    }
+
+    // Salts and tokens come from the kernel CSPRNG, so issued ones don't help to predict the next
+    template <typename Bytes>
+    static Bytes random_bytes() {
+        Bytes bytes;
+        std::size_t filled = 0;
+        while (filled < bytes.size()) {
+            ssize_t got = getrandom(bytes.data() + filled, bytes.size() - filled, 0);
+            if (got < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw std::system_error(errno, std::generic_category(), "getrandom");
+            }
+            filled += static_cast<std::size_t>(got);
+        }
+        return bytes;
+    }
+
+    static Sha256::Digest session_key(const SessionToken& token) {
+        Sha256 sha;
+        sha.update(token.data(), token.size());
+        return sha.finish();
+    }
+
+    unsigned _iterations;
+    unsigned _threads;
+    SessionLimits _limits;
+
+    mutable std::shared_mutex _mutex;
+    std::unordered_map<std::string, Record> _records;
+    std::unordered_map<Sha256::Digest, Session, DigestHash> _sessions;
+    std::deque<std::pair<Clock::time_point, Sha256::Digest>> _expiry;
+    Record _dummy;
+};
+
+
+class IAccount {
+public:
+    virtual ~IAccount() = default;
+    virtual void print_user_info() = 0;
+};
+
+
+class Account : public IAccount {
+public:
+    explicit Account(const std::string& login)
+            : _login(login) {}
+
+    void print_user_info() override {
+        std::cout << "Login: " << _login << '\n';
+    }
+
+    const std::string& get_login() const { return _login; }
+
+private:
+    std::string _login;
+};
+
+
+// Verifies credentials once in log_in(), then every call only checks the session token
+class AccountProxy : public IAccount {
+public:
+    AccountProxy(const std::string& login, VerificationEngine& engine)
+        : _account(login), _engine(engine) {}
+
+    ~AccountProxy() override { log_out(); }
+
+    AccountProxy(const AccountProxy&) = delete;
+    AccountProxy& operator=(const AccountProxy&) = delete;
+
+    // A new login replaces the session of the previous one. Only the owner of the account
+    // can log in, right credentials of another user are rejected.
+    bool log_in(const Credentials& credentials) {
+        log_out();
+        if (credentials.login != _account.get_login())
+            return false;
+
+        _session = _engine.open_session(credentials);
+        return _session.has_value();
+    }
+
+    void log_out() {
+        if (_session)
+            _engine.close_session(*_session);
+        _session.reset();
+    }
+
+    void print_user_info() override {
+        if (_session && _engine.check_session(*_session, _account.get_login())) {
+            std::cout << "Access accepted!" << '\n';
+            _account.print_user_info();
+        }
+        else
+            std::cout << "Access denied." << '\n';
+    }
+
+private:
+    Account _account;
+    VerificationEngine& _engine;
+    std::optional<SessionToken> _session;
+};
+
+
+void client() {
+    VerificationEngine engine;
+    engine.add_user("Alex", "123");
+    engine.add_user("Bob", "456");
+
+    AccountProxy account{"Alex", engine};
+    account.print_user_info();
+
+    account.log_in({"Alex", "124"});
+    account.print_user_info();
+
+    account.log_in({"Alex", "123"});
+    account.print_user_info();
+
+    // Bob's credentials are right, but this is Alex's account
+    account.log_in({"Bob", "456"});
+    account.print_user_info();
+
+    // Session is accepted only until it expires
+    VerificationEngine short_sessions{1000, 1, {std::chrono::milliseconds(1)}};
+    short_sessions.add_user("Alex", "123");
+    AccountProxy short_account{"Alex", short_sessions};
+    short_account.log_in({"Alex", "123"});
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    short_account.print_user_info();
+
+    // RFC 7914 test vector: PBKDF2-HMAC-SHA256("passwd", "salt", 1) starts with 55 ac 04 6e 56 e3 08 9f
+    const std::uint8_t salt[] = {'s', 'a', 'l', 't'};
+    PasswordHash hash = pbkdf2("passwd", salt, 1);
+    const std::uint8_t expected[] = {0x55, 0xac, 0x04, 0x6e, 0x56, 0xe3, 0x08, 0x9f};
+    std::cout << "Known answer: " << (std::memcmp(hash.data(), expected, sizeof(expected)) == 0) << '\n';
+
+    // Access denied.
+    // Access denied.
+    // Access accepted!
+    // Login: Alex
+    // Access denied.
+    // Access denied.
+    // Known answer: 1
+}
+
+
+void benchmark() {
+    constexpr unsigned iterations = 1000;
+    constexpr std::size_t users = 1000;
+    constexpr std::size_t batch = 2000;
+
+    std::vector<Credentials> credentials;
+    for (std::size_t i = 0; i < batch; ++i) {
+        std::size_t user = i % users;
+        // Every fourth password is wrong
+        credentials.push_back({"user" + std::to_string(user), "password" + std::to_string(i % 4 == 3 ? user + 1 : user)});
+    }
+
+    std::cout << "\nPBKDF2-HMAC-SHA256, " << iterations << " iterations, batches of " << batch << '\n';
+
+    for (unsigned threads: {1u, 2u, 4u}) {
+        VerificationEngine engine{iterations, threads};
+        for (std::size_t user = 0; user < users; ++user)
+            engine.add_user("user" + std::to_string(user), "password" + std::to_string(user));
+
+        std::unique_ptr<bool[]> results(new bool[batch]);
+        auto begin = std::chrono::steady_clock::now();
+        engine.verify_batch(credentials, {results.get(), batch});
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+        std::size_t accepted = std::count(results.get(), results.get() + batch, true);
+        std::cout << "verify_batch, " << threads << " threads  |  verifications/s: "
+                  << static_cast<std::uint64_t>(batch / elapsed.count()) << "  |  accepted: " << accepted << '\n';
+    }
+
+    VerificationEngine engine{iterations, 1};
+    engine.add_user("Alex", "123");
+
+    // Unknown login is checked against a dummy record, so it isn't faster than a known one
+    auto time_of = [&](const Credentials& credentials) {
+        constexpr int repeats = 200;
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeats; ++i)
+            engine.verify(credentials);
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - begin;
+        return elapsed.count() / repeats;
+    };
+    std::cout << "verify, known login    |  us: " << time_of({"Alex", "000"}) << '\n';
+    std::cout << "verify, unknown login  |  us: " << time_of({"Bob", "000"}) << '\n';
+
+    auto token = engine.open_session({"Alex", "123"});
+    constexpr std::size_t checks = 1'000'000;
+    std::size_t valid = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < checks; ++i)
+        valid += engine.check_session(*token, "Alex");
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    std::cout << "session token check    |  checks/s: " << static_cast<std::uint64_t>(checks / elapsed.count())
+              << "  |  valid: " << valid << '\n';
+}
+
+
+int main() {
+    client();
+    benchmark();
+
+    return 0;
+}
@@ -0,0 +1,340 @@
+/*
+ * Proxy pattern: virtual proxy with lazy loading
+ *
+ * Intent: same as in Proxy.cpp, a proxy stands in for the real object. AccountProxy there
+ * builds its Account in the constructor. LazyAccountProxy keeps only the account id: the
+ * real Account is loaded from a backing store on first access and kept in a bounded sharded
+ * LRU cache. Millions of proxies cost a few bytes each, only recently used accounts are in memory.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+#include "HeapUsage.h"
+
+
+using AccountId = std::uint64_t;
+
+
+class IAccount {
+public:
+    virtual ~IAccount() = default;
+    virtual void print_user_info() = 0;
+    virtual std::string get_login() = 0;
+};
+
+
+class Account : public IAccount {
+public:
+    Account(const std::string& login, const std::string& password)
+            : _login(login), _password(password) {}
+
+    void print_user_info() override {
+        std::cout << "Login: " << _login << "; "
+                  << "Password: " << _password << '\n';
+    }
+
+    std::string get_login() override { return _login; }
+
+private:
+    std::string _login;
+    std::string _password;
+};
+
+
+// Backing store with fixed size records in a file, record of account `id` is at id * record_size
+class AccountStore {
+public:
+    static constexpr std::size_t field_size = 48;
+    static constexpr std::size_t record_size = 2 * field_size;
+
+    AccountStore()
+        : _file(std::tmpfile()) {
+        if (_file == nullptr)
+            throw std::system_error(errno, std::generic_category(), "tmpfile");
+    }
+
+    ~AccountStore() { std::fclose(_file); }
+
+    AccountStore(const AccountStore&) = delete;
+    AccountStore& operator=(const AccountStore&) = delete;
+
+    void append(std::string_view login, std::string_view password) {
+        char record[record_size] = {};
+        std::memcpy(record, login.data(), std::min(login.size(), field_size - 1));
+        std::memcpy(record + field_size, password.data(), std::min(password.size(), field_size - 1));
+
+        if (std::fwrite(record, record_size, 1, _file) != 1)
+            throw std::system_error(errno, std::generic_category(), "fwrite");
+        ++_size;
+    }
+
+    // Makes appended records visible to load()
+    void flush() {
+        if (std::fflush(_file) != 0)
+            throw std::system_error(errno, std::generic_category(), "fflush");
+    }
+
+    Account load(AccountId id) const {
+        if (id >= _size)
+            throw std::out_of_range("Unknown account: " + std::to_string(id));
+
+        char record[record_size];
+        if (::pread(fileno(_file), record, record_size, static_cast<off_t>(id * record_size)) != record_size)
+            throw std::system_error(errno, std::generic_category(), "pread");
+
+        return Account{std::string(record), std::string(record + field_size)};
+    }
+
+    std::size_t size() const { return _size; }
+
+private:
+    std::FILE* _file;
+    std::size_t _size = 0;
+};
+
+
+struct CacheStats {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t evictions = 0;
+};
+
+
+// Thread safe LRU cache of loaded accounts, as ShardedLruCache in Decorator_with_cache.cpp.
+// Accounts are shared, so an account evicted while somebody uses it lives until they finish.
+class AccountCache {
+public:
+    AccountCache(const AccountStore& store, std::size_t capacity, std::size_t shards = 16)
+        : _store(store) {
+        shards = std::max<std::size_t>(shards, 1);
+        for (std::size_t i = 0; i < shards; ++i)
+            _shards.push_back(std::make_unique<Shard>(std::max<std::size_t>(capacity / shards, 1)));
+    }
+
+    // Returns the cached account or loads it. Load runs without lock, so a slow store
+    // doesn't block the whole shard.
+    std::shared_ptr<Account> get(AccountId id) {
+        Shard& shard = *_shards[id % _shards.size()];
+
+        {
+            std::lock_guard lock(shard.mutex);
+            auto found = shard.index.find(id);
+            if (found != shard.index.end()) {
+                ++shard.stats.hits;
+                shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+                return found->second->account;
+            }
+            ++shard.stats.misses;
+        }
+
+        auto account = std::make_shared<Account>(_store.load(id));
+
+        std::lock_guard lock(shard.mutex);
+        auto found = shard.index.find(id);
+        if (found != shard.index.end()) {
+            // Loaded by another thread meanwhile
+            shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+            return found->second->account;
+        }
+
+        if (shard.entries.size() == shard.capacity) {
+            shard.index.erase(shard.entries.back().id);
+            shard.entries.pop_back();
+            ++shard.stats.evictions;
+        }
+
+        shard.entries.push_front({id, account});
+        shard.index.emplace(id, shard.entries.begin());
+        return account;
+    }
+
+    CacheStats stats() const {
+        CacheStats total;
+        for (const auto& shard: _shards) {
+            std::lock_guard lock(shard->mutex);
+            total.hits += shard->stats.hits;
+            total.misses += shard->stats.misses;
+            total.evictions += shard->stats.evictions;
+        }
+        return total;
+    }
+
+private:
+    struct Entry {
+        AccountId id;
+        std::shared_ptr<Account> account;
+    };
+
+    struct Shard {
+        explicit Shard(std::size_t capacity) : capacity(capacity) {
+            index.reserve(capacity);
+        }
+
+        mutable std::mutex mutex;
+        std::list<Entry> entries;
+        std::unordered_map<AccountId, std::list<Entry>::iterator> index;
+        std::size_t capacity;
+        CacheStats stats;
+    };
+
+    const AccountStore& _store;
+    std::vector<std::unique_ptr<Shard>> _shards;
+};
+
+
+// Virtual proxy: the account is loaded only when it is used
+class LazyAccountProxy : public IAccount {
+public:
+    LazyAccountProxy(AccountId id, AccountCache& cache)
+        : _id(id), _cache(&cache) {}
+
+    void print_user_info() override { _cache->get(_id)->print_user_info(); }
+    std::string get_login() override { return _cache->get(_id)->get_login(); }
+
+private:
+    AccountId _id;
+    AccountCache* _cache;
+};
+
+
+std::string login_of(std::size_t id) { return "user" + std::to_string(id) + "@example.com"; }
+std::string password_of(std::size_t id) { return "secret-password-" + std::to_string(id * 7919); }
+
+
+void client() {
+    AccountStore store;
+    store.append("Alex", "123");
+    store.append("Bob", "qwerty");
+    store.append("Kate", "password");
+    store.flush();
+
+    AccountCache cache{store, 2, 1};
+    std::vector<LazyAccountProxy> accounts;
+    for (AccountId id = 0; id < store.size(); ++id)
+        accounts.emplace_back(id, cache);
+
+    accounts[0].print_user_info();
+    accounts[1].print_user_info();
+    accounts[0].print_user_info();
+    accounts[2].print_user_info();   // evicts Bob
+
+    CacheStats stats = cache.stats();
+    std::cout << "hits: " << stats.hits << ", misses: " << stats.misses << ", evictions: " << stats.evictions << '\n';
+
+    // Login: Alex; Password: 123
+    // Login: Bob; Password: qwerty
+    // Login: Alex; Password: 123
+    // Login: Kate; Password: password
+    // hits: 1, misses: 3, evictions: 1
+}
+
+
+void benchmark() {
+    constexpr std::size_t accounts_count = 2'000'000;
+    constexpr std::size_t cache_capacity = 1 << 16;
+    constexpr std::size_t accesses = 1'000'000;
+
+    AccountStore store;
+    for (std::size_t id = 0; id < accounts_count; ++id)
+        store.append(login_of(id), password_of(id));
+    store.flush();
+
+    std::cout << "\n" << accounts_count << " accounts, cache of " << cache_capacity << " accounts" << '\n';
+
+    std::mt19937_64 random{42};
+    std::vector<AccountId> uniform(accesses);
+    for (auto& id: uniform)
+        id = random() % accounts_count;
+
+    // 90% of accesses go to 1% of accounts
+    std::vector<AccountId> skewed(accesses);
+    for (auto& id: skewed)
+        id = random() % 10 != 0 ? random() % (accounts_count / 100) : random() % accounts_count;
+
+    std::size_t checksum = 0;
+    auto latency = [&](auto& accounts, const std::vector<AccountId>& ids) {
+        auto begin = std::chrono::steady_clock::now();
+        for (AccountId id: ids)
+            checksum += accounts[id].get_login().size();
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - begin;
+        return elapsed.count() / ids.size();
+    };
+
+    {
+        std::size_t before = heap_usage::live_bytes();
+        std::vector<Account> accounts;
+        accounts.reserve(accounts_count);
+        for (std::size_t id = 0; id < accounts_count; ++id)
+            accounts.push_back(store.load(id));
+        std::size_t footprint = heap_usage::live_bytes() - before;
+
+        double ns = latency(accounts, uniform);
+        std::cout << "eager accounts      |  MB in memory: " << footprint / 1e6
+                  << "  |  ns/access: " << ns << '\n';
+    }
+
+    {
+        std::size_t before = heap_usage::live_bytes();
+        AccountCache cache{store, cache_capacity};
+        std::vector<LazyAccountProxy> accounts;
+        accounts.reserve(accounts_count);
+        for (std::size_t id = 0; id < accounts_count; ++id)
+            accounts.emplace_back(id, cache);
+
+        // Fill the cache, so memory is measured at its largest
+        for (std::size_t id = 0; id < cache_capacity * 2; ++id)
+            accounts[id].get_login();
+        std::size_t footprint = heap_usage::live_bytes() - before;
+
+        CacheStats start = cache.stats();
+        double miss_ns = latency(accounts, uniform);
+        CacheStats middle = cache.stats();
+        double skewed_ns = latency(accounts, skewed);
+        CacheStats end = cache.stats();
+
+        auto hit_rate = [](const CacheStats& from, const CacheStats& to) {
+            double hits = to.hits - from.hits;
+            return hits / (hits + to.misses - from.misses);
+        };
+
+        // Hot accounts only, every access is a hit
+        std::vector<AccountId> hot(skewed.begin(), skewed.end());
+        hot.erase(std::remove_if(hot.begin(), hot.end(), [](AccountId id) { return id >= cache_capacity / 4; }), hot.end());
+        latency(accounts, hot);
+        CacheStats hot_start = cache.stats();
+        double hit_ns = latency(accounts, hot);
+        CacheStats hot_end = cache.stats();
+
+        std::cout << "lazy proxies        |  MB in memory: " << footprint / 1e6 << '\n';
+        std::cout << "  uniform accesses  |  ns/access: " << miss_ns << "  |  hit rate: " << hit_rate(start, middle) << '\n';
+        std::cout << "  skewed accesses   |  ns/access: " << skewed_ns << "  |  hit rate: " << hit_rate(middle, end) << '\n';
+        std::cout << "  hot accesses      |  ns/access: " << hit_ns << "  |  hit rate: " << hit_rate(hot_start, hot_end) << '\n';
+    }
+
+    std::cout << "backing store       |  MB on disk: " << accounts_count * AccountStore::record_size / 1e6
+              << "  |  checksum: " << checksum % 1000 << '\n';
+}
+
+
+int main() {
+    client();
+    benchmark();
+
+    return 0;
+}
@@ -0,0 +1,361 @@
+/*
+ * Proxy pattern: remote proxy with batching and pipelining
+ *
+ * Intent: same as in Proxy.cpp, a proxy stands in for the real object. Here the real accounts
+ * live on a server behind a network with a round trip time (RTT), simulated in process.
+ * RemoteAccountProxy makes one request per call and waits a whole round trip for it.
+ * BatchingChannel collects calls of many proxies into one request, and keeps several
+ * requests in flight, so the server handles fewer, larger requests while the next batch
+ * is already on its way.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/prctl.h>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+using AccountId = std::uint64_t;
+
+
+// Runs every message at its delivery time on one thread, in time order
+class SimulatedNetwork {
+public:
+    SimulatedNetwork()
+        : _thread([this] { run(); }) {}
+
+    ~SimulatedNetwork() {
+        {
+            std::lock_guard lock(_mutex);
+            _stop = true;
+        }
+        _wake.notify_one();
+        _thread.join();
+    }
+
+    SimulatedNetwork(const SimulatedNetwork&) = delete;
+    SimulatedNetwork& operator=(const SimulatedNetwork&) = delete;
+
+    void deliver_at(Clock::time_point time, std::function<void()> message) {
+        std::lock_guard lock(_mutex);
+        _messages.push_back({time, _sequence++, std::move(message)});
+        std::push_heap(_messages.begin(), _messages.end(), Later{});
+        if (_messages.front().sequence == _sequence - 1)
+            _wake.notify_one();
+    }
+
+private:
+    struct Message {
+        Clock::time_point time;
+        std::uint64_t sequence;   // keeps order of messages with the same time
+        std::function<void()> deliver;
+    };
+
+    struct Later {
+        bool operator()(const Message& left, const Message& right) const {
+            return left.time != right.time ? left.time > right.time : left.sequence > right.sequence;
+        }
+    };
+
+    void run() {
+        // Default timer slack of 50us would make every short delay 50us longer
+        prctl(PR_SET_TIMERSLACK, 1UL);
+
+        std::unique_lock lock(_mutex);
+        while (!_stop) {
+            if (_messages.empty()) {
+                _wake.wait(lock);
+                continue;
+            }
+            if (Clock::now() < _messages.front().time) {
+                _wake.wait_until(lock, _messages.front().time);
+                continue;
+            }
+
+            std::pop_heap(_messages.begin(), _messages.end(), Later{});
+            Message message = std::move(_messages.back());
+            _messages.pop_back();
+
+            lock.unlock();
+            message.deliver();
+            lock.lock();
+        }
+    }
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::vector<Message> _messages;
+    std::uint64_t _sequence = 0;
+    bool _stop = false;
+    std::thread _thread;
+};
+
+
+// Server with the real accounts. It handles one request at a time, every request costs
+// a fixed overhead plus a bit per account in it.
+struct ServerCosts {
+    Clock::duration per_request = std::chrono::microseconds(20);
+    Clock::duration per_account = std::chrono::nanoseconds(500);
+};
+
+class AccountServer {
+public:
+    AccountServer(SimulatedNetwork& network, Clock::duration rtt, std::size_t accounts, ServerCosts costs = {})
+        : _network(network), _rtt(rtt), _costs(costs) {
+        for (std::size_t id = 0; id < accounts; ++id)
+            _infos.push_back("Login: user" + std::to_string(id) + "; Password: " + std::to_string(id * 7919));
+    }
+
+    // Request travels half of RTT, waits until the server is free, answer travels the other half back.
+    // on_reply is called on the network thread and must be short.
+    void call(std::vector<AccountId> ids, std::function<void(std::vector<std::string>)> on_reply) {
+        _network.deliver_at(Clock::now() + _rtt / 2, [this, ids = std::move(ids), on_reply = std::move(on_reply)] {
+            // Network thread only, no lock is needed
+            Clock::time_point start = std::max(Clock::now(), _busy_until);
+            _busy_until = start + _costs.per_request + _costs.per_account * ids.size();
+
+            std::vector<std::string> infos;
+            infos.reserve(ids.size());
+            for (AccountId id: ids)
+                infos.push_back(_infos.at(id));
+
+            _network.deliver_at(_busy_until + _rtt / 2, [infos = std::move(infos), on_reply]() mutable {
+                on_reply(std::move(infos));
+            });
+        });
+    }
+
+    std::size_t size() const { return _infos.size(); }
+
+private:
+    SimulatedNetwork& _network;
+    Clock::duration _rtt;
+    ServerCosts _costs;
+    std::vector<std::string> _infos;
+    Clock::time_point _busy_until;
+};
+
+
+class IAccount {
+public:
+    virtual ~IAccount() = default;
+    virtual void print_user_info() = 0;
+    virtual std::string get_user_info() = 0;
+};
+
+
+// One request per call
+class RemoteAccountProxy : public IAccount {
+public:
+    RemoteAccountProxy(AccountId id, AccountServer& server)
+        : _id(id), _server(server) {}
+
+    void print_user_info() override { std::cout << get_user_info() << '\n'; }
+
+    std::string get_user_info() override {
+        auto promise = std::make_shared<std::promise<std::string>>();
+        auto reply = promise->get_future();
+        _server.call({_id}, [promise](std::vector<std::string> infos) { promise->set_value(std::move(infos[0])); });
+        return reply.get();
+    }
+
+private:
+    AccountId _id;
+    AccountServer& _server;
+};
+
+
+// Collects calls into batches. A batch is sent at once if less than `max_in_flight` requests
+// are on their way, otherwise calls wait in the queue and go with the next batch when
+// a reply comes back.
+class BatchingChannel {
+public:
+    BatchingChannel(AccountServer& server, std::size_t max_in_flight, std::size_t max_batch = 512)
+        : _server(server), _max_in_flight(std::max<std::size_t>(max_in_flight, 1)),
+          _max_batch(std::max<std::size_t>(max_batch, 1)) {}
+
+    // Future lets one caller have several calls in flight
+    std::future<std::string> get_user_info(AccountId id) {
+        std::promise<std::string> promise;
+        auto reply = promise.get_future();
+
+        std::lock_guard lock(_mutex);
+        _pending.push_back({id, std::move(promise)});
+        if (_in_flight < _max_in_flight)
+            send_batch();
+        return reply;
+    }
+
+    double average_batch() const {
+        std::lock_guard lock(_mutex);
+        return _requests == 0 ? 0 : static_cast<double>(_calls) / _requests;
+    }
+
+private:
+    struct Call {
+        AccountId id;
+        std::promise<std::string> reply;
+    };
+
+    // Called with the mutex locked
+    void send_batch() {
+        std::size_t size = std::min(_pending.size(), _max_batch);
+        auto batch = std::make_shared<std::vector<Call>>(std::make_move_iterator(_pending.begin()),
+                                                         std::make_move_iterator(_pending.begin() + size));
+        _pending.erase(_pending.begin(), _pending.begin() + size);
+
+        std::vector<AccountId> ids;
+        ids.reserve(size);
+        for (const auto& call: *batch)
+            ids.push_back(call.id);
+
+        ++_in_flight;
+        ++_requests;
+        _calls += size;
+
+        _server.call(std::move(ids), [this, batch](std::vector<std::string> infos) {
+            {
+                std::lock_guard lock(_mutex);
+                --_in_flight;
+                if (!_pending.empty())
+                    send_batch();
+            }
+
+            // Last, the channel may be destroyed as soon as its callers get their replies
+            for (std::size_t i = 0; i < batch->size(); ++i)
+                (*batch)[i].reply.set_value(std::move(infos[i]));
+        });
+    }
+
+    AccountServer& _server;
+    std::size_t _max_in_flight;
+    std::size_t _max_batch;
+
+    mutable std::mutex _mutex;
+    std::deque<Call> _pending;
+    std::size_t _in_flight = 0;
+    std::uint64_t _requests = 0;
+    std::uint64_t _calls = 0;
+};
+
+
+class BatchingAccountProxy : public IAccount {
+public:
+    BatchingAccountProxy(AccountId id, BatchingChannel& channel)
+        : _id(id), _channel(channel) {}
+
+    void print_user_info() override { std::cout << get_user_info() << '\n'; }
+    std::string get_user_info() override { return _channel.get_user_info(_id).get(); }
+
+private:
+    AccountId _id;
+    BatchingChannel& _channel;
+};
+
+
+void client() {
+    SimulatedNetwork network;
+    AccountServer server{network, std::chrono::microseconds(500), 3};
+
+    RemoteAccountProxy alex{0, server};
+    alex.print_user_info();
+
+    BatchingChannel channel{server, 1};
+    BatchingAccountProxy bob{1, channel};
+    bob.print_user_info();
+
+    // One caller, three calls in flight
+    std::vector<std::future<std::string>> replies;
+    for (AccountId id = 0; id < 3; ++id)
+        replies.push_back(channel.get_user_info(id));
+    for (auto& reply: replies)
+        std::cout << reply.get() << '\n';
+
+    // Login: user0; Password: 0
+    // Login: user1; Password: 7919
+    // Login: user0; Password: 0
+    // Login: user1; Password: 7919
+    // Login: user2; Password: 15838
+}
+
+
+void benchmark() {
+    constexpr int callers = 64;
+    constexpr int calls_per_caller = 50;
+    constexpr std::size_t accounts = 10'000;
+
+    std::cout << "\n" << callers << " callers, " << calls_per_caller << " calls each, server: 20us per request + 0.5us per account"
+              << '\n';
+
+    for (auto rtt: {std::chrono::microseconds(50), std::chrono::microseconds(500), std::chrono::microseconds(5000)}) {
+        SimulatedNetwork network;
+        AccountServer server{network, rtt, accounts};
+
+        // Every caller measures the latency of its own calls
+        auto measure = [&](const char* name, auto make_proxy, const BatchingChannel* channel) {
+            std::vector<std::vector<double>> latencies(callers);
+            std::vector<std::thread> threads;
+
+            auto begin = Clock::now();
+            for (int caller = 0; caller < callers; ++caller) {
+                threads.emplace_back([&, caller] {
+                    latencies[caller].reserve(calls_per_caller);
+                    for (int call = 0; call < calls_per_caller; ++call) {
+                        auto proxy = make_proxy((caller * calls_per_caller + call) % accounts);
+                        auto start = Clock::now();
+                        proxy.get_user_info();
+                        std::chrono::duration<double, std::micro> latency = Clock::now() - start;
+                        latencies[caller].push_back(latency.count());
+                    }
+                });
+            }
+            for (auto& thread: threads)
+                thread.join();
+            std::chrono::duration<double> elapsed = Clock::now() - begin;
+
+            std::vector<double> all;
+            for (const auto& caller_latencies: latencies)
+                all.insert(all.end(), caller_latencies.begin(), caller_latencies.end());
+            std::sort(all.begin(), all.end());
+            double mean = 0;
+            for (double latency: all)
+                mean += latency / all.size();
+
+            std::cout << "  " << name << "  |  calls/s: " << static_cast<std::uint64_t>(all.size() / elapsed.count())
+                      << "  |  mean us: " << static_cast<std::uint64_t>(mean)
+                      << "  |  p99 us: " << static_cast<std::uint64_t>(all[all.size() * 99 / 100]);
+            if (channel != nullptr)
+                std::cout << "  |  calls/request: " << channel->average_batch();
+            std::cout << '\n';
+        };
+
+        std::cout << "RTT " << std::chrono::duration_cast<std::chrono::microseconds>(rtt).count() << "us" << '\n';
+
+        measure("one call per round trip", [&](AccountId id) { return RemoteAccountProxy{id, server}; }, nullptr);
+
+        for (std::size_t in_flight: {1, 4, 16}) {
+            BatchingChannel channel{server, in_flight};
+            std::string name = "batches, " + std::to_string(in_flight) + " in flight";
+            name.resize(23, ' ');
+            measure(name.c_str(), [&](AccountId id) { return BatchingAccountProxy{id, channel}; }, &channel);
+        }
+    }
+}
+
+
+int main() {
+    client();
+    benchmark();
+
+    return 0;
+}
@@ -14,7 +14,7 @@ class Symbol;
 
 class Glyph {
 public:
-    ~Glyph() = default;
+    virtual ~Glyph() = default;
     virtual std::string get_glyph_info() const = 0;
     virtual void accept(Visitor& visitor) = 0;
 };
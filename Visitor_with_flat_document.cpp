@@ -0,0 +1,277 @@
+/*
+ * Visitor pattern: flat glyph documents
+ *
+ * Intent: same as in Visitor.cpp, new operations over glyphs without changing glyph classes.
+ * Here glyphs are plain values stored in contiguous arrays, one array per glyph type.
+ * A visitor gets a whole array of one type at once, so there is one call per type instead
+ * of two virtual calls per glyph, and loops over arrays can be vectorized.
+ * VariantDocument keeps document order in one std::variant vector for visitors that need it.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <string>
+#include <variant>
+#include <vector>
+
+
+// Glyphs as values
+struct Symbol {
+    char symbol = 'a';
+};
+
+struct Row {
+    int row_number;
+    int elements_in_row;
+};
+
+
+// Visitor which handles all glyphs of one type in one call
+template <typename V>
+concept BatchVisitor = requires(V visitor, std::span<const Row> rows, std::span<const Symbol> symbols) {
+    visitor.visit(rows);
+    visitor.visit(symbols);
+};
+
+
+// Type-segregated document: all rows in one array, all symbols in another
+class FlatDocument {
+public:
+    void add(Row row) { _rows.push_back(row); }
+    void add(Symbol symbol) { _symbols.push_back(symbol); }
+
+    void reserve(std::size_t rows, std::size_t symbols) {
+        _rows.reserve(rows);
+        _symbols.reserve(symbols);
+    }
+
+    template <BatchVisitor V>
+    void accept(V& visitor) const {
+        visitor.visit(std::span<const Row>(_rows));
+        visitor.visit(std::span<const Symbol>(_symbols));
+    }
+
+    std::size_t size() const { return _rows.size() + _symbols.size(); }
+    std::size_t bytes() const { return _rows.size() * sizeof(Row) + _symbols.size() * sizeof(Symbol); }
+
+private:
+    std::vector<Row> _rows;
+    std::vector<Symbol> _symbols;
+};
+
+
+// Document in reading order, glyph type is the variant index
+class VariantDocument {
+public:
+    using Glyph = std::variant<Row, Symbol>;
+
+    void add(Glyph glyph) { _glyphs.push_back(glyph); }
+    void reserve(std::size_t glyphs) { _glyphs.reserve(glyphs); }
+
+    // Visitor is called per glyph with Row or Symbol, dispatch is a jump on the index
+    template <typename V>
+    void accept(V& visitor) const {
+        for (const auto& glyph: _glyphs)
+            std::visit(visitor, glyph);
+    }
+
+    std::size_t size() const { return _glyphs.size(); }
+
+private:
+    std::vector<Glyph> _glyphs;
+};
+
+
+// Row * Number of elements from AdvancedVisitor, summed over the document, and a checksum of symbols
+class SumVisitor {
+public:
+    void visit(std::span<const Row> rows) {
+        for (const auto& row: rows)
+            _area += static_cast<std::int64_t>(row.row_number) * row.elements_in_row;
+    }
+
+    void visit(std::span<const Symbol> symbols) {
+        for (const auto& symbol: symbols)
+            _checksum += static_cast<unsigned char>(symbol.symbol);
+    }
+
+    // Single glyphs, used by VariantDocument
+    void operator()(const Row& row) { _area += static_cast<std::int64_t>(row.row_number) * row.elements_in_row; }
+    void operator()(const Symbol& symbol) { _checksum += static_cast<unsigned char>(symbol.symbol); }
+
+    std::int64_t area() const { return _area; }
+    std::uint64_t checksum() const { return _checksum; }
+
+private:
+    std::int64_t _area = 0;
+    std::uint64_t _checksum = 0;
+};
+
+
+// Glyphs and visitor from Visitor.cpp, used as baseline
+namespace classic {
+
+class Visitor;
+
+class Glyph {
+public:
+    virtual ~Glyph() = default;
+    virtual void accept(Visitor& visitor) = 0;
+};
+
+class Symbol;
+class Row;
+
+class Visitor {
+public:
+    virtual ~Visitor() = default;
+    virtual void visit(Row& row) = 0;
+    virtual void visit(Symbol& symbol) = 0;
+};
+
+class Symbol : public Glyph {
+public:
+    Symbol(char symbol = 'a') : symbol(symbol) {}
+    void accept(Visitor& visitor) override { visitor.visit(*this); }
+    char get_symbol() const { return symbol; }
+
+private:
+    char symbol;
+};
+
+class Row : public Glyph {
+public:
+    Row(int row_number, int elements_in_row)
+        : _row_number(row_number), _elements_in_row(elements_in_row) {}
+
+    int get_row_number() const { return _row_number; }
+    int get_elements_in_row() const { return _elements_in_row; }
+    void accept(Visitor& visitor) override { visitor.visit(*this); }
+
+private:
+    int _row_number;
+    int _elements_in_row;
+};
+
+class SumVisitor : public Visitor {
+public:
+    void visit(Row& row) override { _area += static_cast<std::int64_t>(row.get_row_number()) * row.get_elements_in_row(); }
+    void visit(Symbol& symbol) override { _checksum += static_cast<unsigned char>(symbol.get_symbol()); }
+
+    std::int64_t area() const { return _area; }
+    std::uint64_t checksum() const { return _checksum; }
+
+private:
+    std::int64_t _area = 0;
+    std::uint64_t _checksum = 0;
+};
+
+}   // namespace classic
+
+
+// Every row is followed by its symbols
+constexpr int symbols_in_row = 9;
+
+char symbol_at(std::size_t i) { return static_cast<char>('a' + i % 26); }
+
+
+void client() {
+    FlatDocument document;
+    VariantDocument ordered;
+
+    for (int row = 0; row < 3; ++row) {
+        document.add(Row{row + 1, symbols_in_row});
+        ordered.add(Row{row + 1, symbols_in_row});
+        for (int i = 0; i < symbols_in_row; ++i) {
+            document.add(Symbol{symbol_at(i)});
+            ordered.add(Symbol{symbol_at(i)});
+        }
+    }
+
+    SumVisitor flat_sum;
+    document.accept(flat_sum);
+
+    SumVisitor ordered_sum;
+    ordered.accept(ordered_sum);
+
+    std::cout << "Glyphs: " << document.size() << '\n';
+    std::cout << "Row * Number of elements, summed: " << flat_sum.area() << '\n';
+    std::cout << "Same as in reading order: "
+              << (flat_sum.area() == ordered_sum.area() && flat_sum.checksum() == ordered_sum.checksum()) << '\n';
+
+    // Glyphs: 30
+    // Row * Number of elements, summed: 54
+    // Same as in reading order: 1
+}
+
+
+void benchmark() {
+    // 100M glyphs as separate heap objects take several GB, 20M fit into memory of a laptop
+    constexpr std::size_t rows = 2'000'000;
+    constexpr std::size_t glyphs = rows * (symbols_in_row + 1);
+
+    FlatDocument flat;
+    flat.reserve(rows, rows * symbols_in_row);
+    VariantDocument ordered;
+    ordered.reserve(glyphs);
+    std::vector<std::unique_ptr<classic::Glyph>> nodes;
+    nodes.reserve(glyphs);
+
+    for (std::size_t row = 0; row < rows; ++row) {
+        int number = static_cast<int>(row);
+        flat.add(Row{number, symbols_in_row});
+        ordered.add(Row{number, symbols_in_row});
+        nodes.push_back(std::make_unique<classic::Row>(number, symbols_in_row));
+
+        for (int i = 0; i < symbols_in_row; ++i) {
+            flat.add(Symbol{symbol_at(i)});
+            ordered.add(Symbol{symbol_at(i)});
+            nodes.push_back(std::make_unique<classic::Symbol>(symbol_at(i)));
+        }
+    }
+
+    auto report = [](const char* name, std::chrono::duration<double> elapsed, std::int64_t area) {
+        std::cout << name << "  |  glyphs/s: " << static_cast<std::uint64_t>(glyphs / elapsed.count())
+                  << "  |  ns/glyph: " << elapsed.count() * 1e9 / glyphs
+                  << "  |  area: " << area << '\n';
+    };
+
+    std::cout << "\nvisiting " << glyphs << " glyphs" << '\n';
+
+    {
+        classic::SumVisitor visitor;
+        auto begin = std::chrono::steady_clock::now();
+        for (auto& node: nodes)
+            node->accept(visitor);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        report("double dispatch, heap nodes ", elapsed, visitor.area());
+    }
+
+    {
+        SumVisitor visitor;
+        auto begin = std::chrono::steady_clock::now();
+        ordered.accept(visitor);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        report("std::variant vector         ", elapsed, visitor.area());
+    }
+
+    {
+        SumVisitor visitor;
+        auto begin = std::chrono::steady_clock::now();
+        flat.accept(visitor);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        report("type-segregated arrays      ", elapsed, visitor.area());
+        std::cout << "type-segregated arrays        |  GB/s: " << flat.bytes() / elapsed.count() / 1e9 << '\n';
+    }
+}
+
+
+int main() {
+    client();
+    benchmark();
+
+    return 0;
+}
@@ -0,0 +1,305 @@
+/*
+ * Visitor pattern: allocation-free glyph info
+ *
+ * Intent: same as in Visitor.cpp. get_glyph_info() there returns a new std::string for every
+ * glyph, and Row builds it from four temporaries. Here glyphs render their info into a
+ * caller-supplied buffer through TextSink, numbers are formatted with std::to_chars.
+ * A whole document renders into one buffer, which keeps its memory between renders.
+ */
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "HeapUsage.h"
+
+// Growing text buffer which keeps its memory after clear(). First `inline_size` chars
+// live inside the buffer, so short texts don't allocate at all.
+class TextBuffer {
+public:
+    static constexpr std::size_t inline_size = 64;
+
+    TextBuffer() = default;
+    TextBuffer(const TextBuffer&) = delete;
+    TextBuffer& operator=(const TextBuffer&) = delete;
+
+    // Returns space for at least `count` more chars, commit() tells how many were written
+    char* reserve(std::size_t count) {
+        if (_size + count > _capacity) {
+            std::size_t capacity = std::max(_capacity * 2, _size + count);
+            auto heap = std::make_unique<char[]>(capacity);
+            if (_size != 0)
+                std::memcpy(heap.get(), _data, _size);
+            _heap = std::move(heap);
+            _data = _heap.get();
+            _capacity = capacity;
+        }
+        return _data + _size;
+    }
+
+    void commit(std::size_t count) { _size += count; }
+    void clear() { _size = 0; }
+
+    std::size_t size() const { return _size; }
+    std::string_view view() const { return {_data, _size}; }
+
+private:
+    char _inline[inline_size];
+    std::unique_ptr<char[]> _heap;
+    char* _data = _inline;
+    std::size_t _size = 0;
+    std::size_t _capacity = inline_size;
+};
+
+
+// fmt-style sink: write("Row ", 2, " with ", 3) appends all arguments with one reserve()
+class TextSink {
+public:
+    explicit TextSink(TextBuffer& buffer)
+        : _buffer(buffer) {}
+
+    template <typename... Args>
+    TextSink& write(const Args&... args) {
+        char* begin = _buffer.reserve((max_size(args) + ...));
+        char* out = begin;
+        ((out = put(out, args)), ...);
+        _buffer.commit(out - begin);
+        return *this;
+    }
+
+private:
+    static std::size_t max_size(char) { return 1; }
+    static std::size_t max_size(std::string_view text) { return text.size(); }
+    static std::size_t max_size(std::integral auto) { return 20; }
+
+    static char* put(char* out, char symbol) {
+        *out = symbol;
+        return out + 1;
+    }
+
+    static char* put(char* out, std::string_view text) {
+        std::memcpy(out, text.data(), text.size());
+        return out + text.size();
+    }
+
+    static char* put(char* out, std::integral auto number) { return std::to_chars(out, out + 20, number).ptr; }
+
+    TextBuffer& _buffer;
+};
+
+
+class Visitor;
+class Row;
+class Symbol;
+
+class Glyph {
+public:
+    virtual ~Glyph() = default;
+
+    // Appends glyph info to the sink, doesn't allocate once the buffer is large enough
+    virtual void render_glyph_info(TextSink& sink) const = 0;
+    virtual void accept(Visitor& visitor) = 0;
+
+    // Old interface, kept for callers which need an owning string. Info is rendered into
+    // the inline part of a buffer on the stack, so only the string itself may allocate.
+    std::string get_glyph_info() const {
+        TextBuffer buffer;
+        TextSink sink{buffer};
+        render_glyph_info(sink);
+        return std::string(buffer.view());
+    }
+};
+
+class Visitor {
+public:
+    virtual ~Visitor() = default;
+    virtual void visit(Row& row) = 0;
+    virtual void visit(Symbol& symbol) = 0;
+};
+
+// Components
+class Symbol : public Glyph {
+public:
+    Symbol(char symbol = 'a')
+        : symbol(symbol) {}
+
+    void render_glyph_info(TextSink& sink) const override {
+        sink.write(symbol);
+    }
+
+    void accept(Visitor& visitor) override {
+        visitor.visit(*this);
+    }
+
+private:
+    char symbol;
+};
+
+class Row : public Glyph {
+public:
+    Row(int row_number, int elements_in_row)
+        : _row_number(row_number), _elements_in_row(elements_in_row) {}
+
+    void render_glyph_info(TextSink& sink) const override {
+        sink.write("Row ", _row_number, " with ", _elements_in_row, " elements");
+    }
+
+    int get_row_number() const { return _row_number; }
+    int get_elements_in_row() const { return _elements_in_row; }
+
+    void accept(Visitor& visitor) override {
+        visitor.visit(*this);
+    }
+
+private:
+    int _row_number;
+    int _elements_in_row;
+};
+
+
+// SimpleVisitor from Visitor.cpp, writes into a sink instead of std::cout
+class SimpleVisitor : public Visitor {
+public:
+    explicit SimpleVisitor(TextSink& sink)
+        : _sink(sink) {}
+
+    void visit(Row& row) override {
+        _sink.write("Simple visitor\n");
+        row.render_glyph_info(_sink);
+        _sink.write('\n');
+    }
+
+    void visit(Symbol& symbol) override {
+        _sink.write("Simple visitor\n");
+        symbol.render_glyph_info(_sink);
+        _sink.write('\n');
+    }
+
+private:
+    TextSink& _sink;
+};
+
+
+// Info of every glyph on its own line
+void render_document(const std::vector<std::unique_ptr<Glyph>>& document, TextSink& sink) {
+    for (const auto& glyph: document) {
+        glyph->render_glyph_info(sink);
+        sink.write('\n');
+    }
+}
+
+
+// get_glyph_info() from Visitor.cpp, used as baseline
+namespace baseline {
+
+std::string row_info(int row_number, int elements_in_row) {
+    return "Row " + std::to_string(row_number) + " with " + std::to_string(elements_in_row) + " elements";
+}
+
+std::string symbol_info(char symbol) {
+    return {symbol};
+}
+
+}   // namespace baseline
+
+
+void client() {
+    Row row1(2, 3);
+    Symbol symbol('x');
+
+    TextBuffer buffer;
+    TextSink sink{buffer};
+    SimpleVisitor simple_visitor{sink};
+
+    row1.accept(simple_visitor);
+    symbol.accept(simple_visitor);
+    std::cout << buffer.view();
+
+    std::cout << "Same as before: " << (row1.get_glyph_info() == baseline::row_info(2, 3)) << '\n';
+
+    // Simple visitor
+    // Row 2 with 3 elements
+    // Simple visitor
+    // x
+    // Same as before: 1
+}
+
+
+void benchmark() {
+    constexpr std::size_t rows = 1'000'000;
+    constexpr int symbols_in_row = 9;
+    constexpr std::size_t glyphs = rows * (symbols_in_row + 1);
+
+    std::vector<std::unique_ptr<Glyph>> document;
+    document.reserve(glyphs);
+    for (std::size_t row = 0; row < rows; ++row) {
+        document.push_back(std::make_unique<Row>(static_cast<int>(row), symbols_in_row));
+        for (int i = 0; i < symbols_in_row; ++i)
+            document.push_back(std::make_unique<Symbol>(static_cast<char>('a' + i)));
+    }
+
+    auto report = [](const char* name, std::chrono::duration<double> elapsed, std::size_t allocated, std::size_t bytes) {
+        std::cout << name << "  |  glyphs/s: " << static_cast<std::uint64_t>(glyphs / elapsed.count())
+                  << "  |  allocations/glyph: " << static_cast<double>(allocated) / glyphs
+                  << "  |  MB: " << bytes / 1e6 << '\n';
+    };
+
+    std::cout << "\nrendering " << glyphs << " glyphs" << '\n';
+
+    {
+        // Same text built by the old code: a string per glyph, appended to the document
+        std::string text;
+        std::size_t before = heap_usage::allocations();
+        auto begin = std::chrono::steady_clock::now();
+        for (std::size_t row = 0; row < rows; ++row) {
+            text += baseline::row_info(static_cast<int>(row), symbols_in_row);
+            text += '\n';
+            for (int i = 0; i < symbols_in_row; ++i) {
+                text += baseline::symbol_info(static_cast<char>('a' + i));
+                text += '\n';
+            }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        report("std::to_string + operator+  ", elapsed, heap_usage::allocations() - before, text.size());
+    }
+
+    {
+        std::string text;
+        std::size_t before = heap_usage::allocations();
+        auto begin = std::chrono::steady_clock::now();
+        for (const auto& glyph: document) {
+            text += glyph->get_glyph_info();
+            text += '\n';
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        report("get_glyph_info() wrapper    ", elapsed, heap_usage::allocations() - before, text.size());
+    }
+
+    // The second render reuses memory of the first one
+    TextBuffer buffer;
+    TextSink sink{buffer};
+    for (const char* name: {"render_document, new buffer ", "render_document, reused     "}) {
+        buffer.clear();
+        std::size_t before = heap_usage::allocations();
+        auto begin = std::chrono::steady_clock::now();
+        render_document(document, sink);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        report(name, elapsed, heap_usage::allocations() - before, buffer.size());
+    }
+}
+
+
+int main() {
+    client();
+    benchmark();
+
+    return 0;
+}
@@ -0,0 +1,227 @@
+/*
+ * Visitor pattern: parallel traversal
+ *
+ * Intent: same as in Visitor.cpp. Visitors here compute aggregates instead of printing,
+ * so a document can be visited by several threads at once. The driver splits glyph arrays
+ * into chunks, every chunk is visited by its own clone of the visitor, and clones are
+ * combined in chunk order with a reduce function given by the caller.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <iostream>
+#include <span>
+#include <thread>
+#include <vector>
+
+
+struct Symbol {
+    char symbol = 'a';
+};
+
+struct Row {
+    int row_number;
+    int elements_in_row;
+};
+
+
+template <typename V>
+concept BatchVisitor = requires(V visitor, std::span<const Row> rows, std::span<const Symbol> symbols) {
+    visitor.visit(rows);
+    visitor.visit(symbols);
+};
+
+
+// Type-segregated document from Visitor_with_flat_document.cpp
+class FlatDocument {
+public:
+    void add(Row row) { _rows.push_back(row); }
+    void add(Symbol symbol) { _symbols.push_back(symbol); }
+
+    void reserve(std::size_t rows, std::size_t symbols) {
+        _rows.reserve(rows);
+        _symbols.reserve(symbols);
+    }
+
+    template <BatchVisitor V>
+    void accept(V& visitor) const {
+        visitor.visit(rows());
+        visitor.visit(symbols());
+    }
+
+    std::span<const Row> rows() const { return _rows; }
+    std::span<const Symbol> symbols() const { return _symbols; }
+    std::size_t size() const { return _rows.size() + _symbols.size(); }
+
+private:
+    std::vector<Row> _rows;
+    std::vector<Symbol> _symbols;
+};
+
+
+// Visits every chunk of `chunk_glyphs` glyphs with a clone of `prototype` and folds the clones
+// into the first one with reduce(result, clone). Workers take chunks from a shared counter,
+// so a slow worker doesn't hold back the others. Clones are reduced in chunk order, so the
+// result doesn't depend on the number of threads or on which thread took which chunk.
+template <BatchVisitor V, typename Reduce>
+requires std::copy_constructible<V> && std::invocable<Reduce&, V&, const V&>
+V parallel_accept(const FlatDocument& document, const V& prototype, Reduce reduce,
+                  unsigned threads = std::thread::hardware_concurrency(), std::size_t chunk_glyphs = 1 << 16) {
+    threads = std::max(threads, 1u);
+
+    std::span<const Row> rows = document.rows();
+    std::span<const Symbol> symbols = document.symbols();
+    std::size_t row_chunks = (rows.size() + chunk_glyphs - 1) / chunk_glyphs;
+    std::size_t chunks = row_chunks + (symbols.size() + chunk_glyphs - 1) / chunk_glyphs;
+    if (chunks == 0)
+        return prototype;
+
+    std::atomic<std::size_t> next{0};
+    std::vector<V> clones(chunks, prototype);
+
+    auto work = [&] {
+        for (std::size_t chunk = next.fetch_add(1, std::memory_order_relaxed); chunk < chunks;
+             chunk = next.fetch_add(1, std::memory_order_relaxed)) {
+            // Works on a local copy, so clones of neighbouring chunks don't share cache lines
+            V visitor = prototype;
+            if (chunk < row_chunks) {
+                std::size_t begin = chunk * chunk_glyphs;
+                visitor.visit(rows.subspan(begin, std::min(chunk_glyphs, rows.size() - begin)));
+            }
+            else {
+                std::size_t begin = (chunk - row_chunks) * chunk_glyphs;
+                visitor.visit(symbols.subspan(begin, std::min(chunk_glyphs, symbols.size() - begin)));
+            }
+            clones[chunk] = std::move(visitor);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t)
+        workers.emplace_back(work);
+
+    work();
+
+    for (auto& worker: workers)
+        worker.join();
+
+    for (std::size_t chunk = 1; chunk < chunks; ++chunk)
+        reduce(clones[0], clones[chunk]);
+
+    return std::move(clones[0]);
+}
+
+
+// Row * Number of elements from AdvancedVisitor, summed over the document
+class AreaVisitor {
+public:
+    void visit(std::span<const Row> rows) {
+        for (const auto& row: rows)
+            _area += static_cast<std::int64_t>(row.row_number) * row.elements_in_row;
+    }
+
+    void visit(std::span<const Symbol>) {}
+
+    static void reduce(AreaVisitor& result, const AreaVisitor& other) { result._area += other._area; }
+
+    std::int64_t area() const { return _area; }
+
+private:
+    std::int64_t _area = 0;
+};
+
+
+// How many times every symbol occurs
+class HistogramVisitor {
+public:
+    void visit(std::span<const Row>) {}
+
+    void visit(std::span<const Symbol> symbols) {
+        for (const auto& symbol: symbols)
+            ++_counts[static_cast<unsigned char>(symbol.symbol)];
+    }
+
+    static void reduce(HistogramVisitor& result, const HistogramVisitor& other) {
+        for (std::size_t i = 0; i < result._counts.size(); ++i)
+            result._counts[i] += other._counts[i];
+    }
+
+    std::uint64_t count(char symbol) const { return _counts[static_cast<unsigned char>(symbol)]; }
+
+private:
+    std::array<std::uint64_t, 256> _counts{};
+};
+
+
+constexpr int symbols_in_row = 9;
+
+FlatDocument make_document(std::size_t rows) {
+    FlatDocument document;
+    document.reserve(rows, rows * symbols_in_row);
+
+    for (std::size_t row = 0; row < rows; ++row) {
+        document.add(Row{static_cast<int>(row % 100'000), symbols_in_row});
+        for (int i = 0; i < symbols_in_row; ++i)
+            document.add(Symbol{static_cast<char>('a' + (row + i) % 26)});
+    }
+    return document;
+}
+
+
+void client() {
+    FlatDocument document = make_document(1000);
+
+    AreaVisitor sequential;
+    document.accept(sequential);
+
+    AreaVisitor parallel = parallel_accept(document, AreaVisitor{}, AreaVisitor::reduce, 4, 100);
+    HistogramVisitor histogram = parallel_accept(document, HistogramVisitor{}, HistogramVisitor::reduce, 4, 100);
+
+    std::cout << "Row * Number of elements, summed: " << parallel.area() << '\n';
+    std::cout << "Same as sequential: " << (parallel.area() == sequential.area()) << '\n';
+    std::cout << "Symbols 'a': " << histogram.count('a') << '\n';
+
+    // Row * Number of elements, summed: 4495500
+    // Same as sequential: 1
+    // Symbols 'a': 343
+}
+
+
+void benchmark() {
+    constexpr std::size_t rows = 10'000'000;
+    FlatDocument document = make_document(rows);
+
+    unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<unsigned> thread_counts;
+    for (unsigned threads = 1; threads < cores; threads *= 2)
+        thread_counts.push_back(threads);
+    thread_counts.push_back(cores);
+
+    std::cout << "\nreduction over " << document.size() << " glyphs, " << cores << " hardware threads" << '\n';
+
+    for (unsigned threads: thread_counts) {
+        auto measure = [&](const auto& prototype, auto reduce) {
+            auto begin = std::chrono::steady_clock::now();
+            auto result = parallel_accept(document, prototype, reduce, threads);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+            asm volatile("" : : "r"(&result) : "memory");
+            return static_cast<std::uint64_t>(document.size() / elapsed.count());
+        };
+
+        std::cout << "threads: " << threads
+                  << "  |  area glyphs/s: " << measure(AreaVisitor{}, AreaVisitor::reduce)
+                  << "  |  histogram glyphs/s: " << measure(HistogramVisitor{}, HistogramVisitor::reduce) << '\n';
+    }
+}
+
+
+int main() {
+    client();
+    benchmark();
+
+    return 0;
+}